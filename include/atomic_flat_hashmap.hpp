@@ -0,0 +1,332 @@
+#ifndef ATOMIC_FLAT_HASHMAP_HPP
+#define ATOMIC_FLAT_HASHMAP_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include "epoch_reclaimer.hpp"
+#include "map_traits.hpp"
+#include "striped_counter.hpp"
+using namespace std;
+
+// Same get/put/remove API as ConcurrentHashMap, for integral keys and
+// integral or floating-point values of up to 8 bytes - account ID to net
+// position, say. There are no locks and no per-entry allocations: the table
+// is a flat array of {atomic key word, atomic value word} slots.
+//
+// Following Cliff Click's non-blocking map, a key is claimed into an empty
+// slot with one CAS and then never leaves it; put() and remove() only swap
+// the value word, and remove() leaves a tombstone. Linear probing stops at
+// the first empty key, so get() is a handful of atomic loads.
+//
+// One key and one value bit pattern are reserved as markers when the type is
+// a full 8 bytes (the minimum for signed types, the maximum for unsigned,
+// and a signalling NaN for doubles); smaller types don't lose anything.
+// put() throws invalid_argument for them.
+//
+// Growing a table is the one time writers wait: once 3/4 of the slots have
+// been claimed, the next writer freezes the table, waits for writers already
+// inside to finish, and copies the live entries to a fresh table. Readers
+// never wait; retired tables are freed through EpochReclaimer. Size the map
+// up front and it never resizes at all.
+template<typename Key, typename Value>
+class AtomicFlatHashMap {
+private:
+    static_assert(is_integral_v<Key> && sizeof(Key) <= sizeof(uint64_t),
+                  "AtomicFlatHashMap keys must be integers of at most 8 bytes");
+    static_assert((is_integral_v<Value> || is_floating_point_v<Value>) && sizeof(Value) <= sizeof(uint64_t),
+                  "AtomicFlatHashMap values must be integers or floating point of at most 8 bytes");
+
+    static constexpr size_t MinCapacity = 16;
+
+    template<typename T>
+    static uint64_t encode(T value) {
+        uint64_t word = 0;
+        memcpy(&word, &value, sizeof(T));
+        return word;
+    }
+
+    template<typename T>
+    static T decode(uint64_t word) {
+        T value;
+        memcpy(&value, &word, sizeof(T));
+        return value;
+    }
+
+    // Narrow types never set bit 63, so that's a free marker for them.
+    template<typename T>
+    static constexpr uint64_t reservedWord() {
+        if constexpr (sizeof(T) < sizeof(uint64_t)) {
+            return uint64_t(1) << 63;
+        } else if constexpr (is_floating_point_v<T>) {
+            return 0x7FF4DEADBEEF0001ull;
+        } else if constexpr (is_signed_v<T>) {
+            return uint64_t(1) << 63;  // numeric_limits<T>::min()
+        } else {
+            return ~uint64_t(0);       // numeric_limits<T>::max()
+        }
+    }
+
+    static constexpr uint64_t EmptyKey = reservedWord<Key>();
+    static constexpr uint64_t Tombstone = reservedWord<Value>();
+
+    struct Slot {
+        atomic<uint64_t> key{EmptyKey};
+        atomic<uint64_t> value{Tombstone};  // also "never written"
+    };
+
+    struct Table {
+        explicit Table(size_t n) : capacity(n), slots(new Slot[n]) {
+            for (size_t bits = n; bits > 1; bits >>= 1) {
+                --shift;
+            }
+        }
+
+        const size_t capacity;
+        unsigned shift = 64;
+        unique_ptr<Slot[]> slots;
+
+        // Kept off the line that get() reads capacity and slots from.
+        alignas(CacheLineSize) atomic<size_t> claimed{0};
+
+        // Writers announce themselves on their stripe before touching the
+        // table; a resize sets `frozen` and then waits for every stripe to
+        // drain.
+        atomic<bool> frozen{false};
+        struct alignas(CacheLineSize) WriterStripe {
+            atomic<uint32_t> inside{0};
+        };
+        array<WriterStripe, StripedCounter::Stripes> writers;
+    };
+
+    atomic<Table*> table_;
+    StripedCounter count_;
+
+    static size_t roundUpCapacity(size_t n) {
+        size_t capacity = MinCapacity;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    static size_t home(const Table& table, uint64_t keyWord) {
+        return static_cast<size_t>((keyWord * 0x9E3779B97F4A7C15ull) >> table.shift);
+    }
+
+    static const Slot* findSlot(const Table& table, uint64_t keyWord) {
+        size_t mask = table.capacity - 1;
+        size_t index = home(table, keyWord);
+        for (size_t probe = 0; probe < table.capacity; ++probe, index = (index + 1) & mask) {
+            uint64_t current = table.slots[index].key.load(memory_order_acquire);
+            if (current == keyWord) {
+                return &table.slots[index];
+            }
+            if (current == EmptyKey) {
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // Finds the key's slot, claiming an empty one if it has none yet.
+    // Returns null if the table is out of slots.
+    static Slot* claimSlot(Table& table, uint64_t keyWord) {
+        size_t mask = table.capacity - 1;
+        size_t index = home(table, keyWord);
+        for (size_t probe = 0; probe < table.capacity; ++probe, index = (index + 1) & mask) {
+            Slot& slot = table.slots[index];
+            uint64_t current = slot.key.load(memory_order_acquire);
+            if (current == EmptyKey &&
+                slot.key.compare_exchange_strong(current, keyWord, memory_order_acq_rel)) {
+                table.claimed.fetch_add(1, memory_order_relaxed);
+                return &slot;
+            }
+            // Either the slot was taken already or we just lost the race
+            // for it; `current` holds the winner's key in both cases.
+            if (current == keyWord) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    bool enterWrite(Table& table) {
+        auto& stripe = table.writers[StripedCounter::stripeIndex()].inside;
+        stripe.fetch_add(1, memory_order_seq_cst);
+        if (table.frozen.load(memory_order_seq_cst)) {
+            stripe.fetch_sub(1, memory_order_release);
+            return false;
+        }
+        return true;
+    }
+
+    void leaveWrite(Table& table) {
+        table.writers[StripedCounter::stripeIndex()].inside.fetch_sub(1, memory_order_release);
+    }
+
+    void waitForResize(Table* table) {
+        while (table_.load(memory_order_acquire) == table) {
+            this_thread::yield();
+        }
+    }
+
+    bool needsResize(const Table& table) const {
+        return table.claimed.load(memory_order_relaxed) * 4 > table.capacity * 3;
+    }
+
+    // Replaces `table` with a clean copy of its live entries. Only the
+    // thread that freezes the table does the work; the rest wait for it.
+    void resize(Table* table) {
+        bool expected = false;
+        if (!table->frozen.compare_exchange_strong(expected, true, memory_order_seq_cst)) {
+            waitForResize(table);
+            return;
+        }
+        for (auto& stripe : table->writers) {
+            while (stripe.inside.load(memory_order_seq_cst) != 0) {
+                this_thread::yield();
+            }
+        }
+
+        // Double only if live entries, not tombstones, filled the table.
+        size_t live = count_.approximate();
+        size_t capacity = max(table->capacity, roundUpCapacity(live * 2 + 1));
+        auto* next = new Table(capacity);
+        for (size_t i = 0; i < table->capacity; ++i) {
+            const Slot& slot = table->slots[i];
+            uint64_t value = slot.value.load(memory_order_relaxed);
+            if (value != Tombstone) {
+                Slot* target = claimSlot(*next, slot.key.load(memory_order_relaxed));
+                target->value.store(value, memory_order_relaxed);
+            }
+        }
+        table_.store(next, memory_order_release);
+        EpochReclaimer::instance().retire(table);
+    }
+
+    static void checkKey(uint64_t keyWord) {
+        if (keyWord == EmptyKey) {
+            throw invalid_argument("AtomicFlatHashMap: key is reserved as the empty marker");
+        }
+    }
+
+    static void checkValue(uint64_t valueWord) {
+        if (valueWord == Tombstone) {
+            throw invalid_argument("AtomicFlatHashMap: value is reserved as the tombstone marker");
+        }
+    }
+
+    // Runs op(table) with the write gate held, resizing and retrying as
+    // needed. op returns false if it ran out of slots.
+    template<typename Op>
+    void write(Op&& op) {
+        for (;;) {
+            EpochReclaimer::Guard guard;
+            Table* table = table_.load(memory_order_acquire);
+            if (!enterWrite(*table)) {
+                waitForResize(table);
+                continue;
+            }
+            bool done = op(*table);
+            leaveWrite(*table);
+            if (!done || needsResize(*table)) {
+                resize(table);
+            }
+            if (done) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit AtomicFlatHashMap(size_t initialCapacity = 1024)
+        : table_(new Table(roundUpCapacity(initialCapacity * 4 / 3 + 1))) {}
+
+    ~AtomicFlatHashMap() {
+        delete table_.load(memory_order_relaxed);
+    }
+
+    AtomicFlatHashMap(const AtomicFlatHashMap&) = delete;
+    AtomicFlatHashMap& operator = (const AtomicFlatHashMap&) = delete;
+
+    optional<Value> get(const Key& key) const {
+        uint64_t keyWord = encode(key);
+        EpochReclaimer::Guard guard;
+        for (;;) {
+            Table* table = table_.load(memory_order_acquire);
+            const Slot* slot = findSlot(*table, keyWord);
+            uint64_t value = slot ? slot->value.load(memory_order_acquire) : Tombstone;
+            // A frozen table's values can't change, but once its successor
+            // is published, writers move on to it; only trust what we read
+            // if the table was still current afterwards.
+            if (table_.load(memory_order_acquire) == table) {
+                return value == Tombstone ? nullopt : optional<Value>(decode<Value>(value));
+            }
+        }
+    }
+
+    bool contains(const Key& key) const {
+        return get(key).has_value();
+    }
+
+    void put(const Key& key, const Value& value) {
+        uint64_t keyWord = encode(key);
+        uint64_t valueWord = encode(value);
+        checkKey(keyWord);
+        checkValue(valueWord);
+        write([&](Table& table) {
+            Slot* slot = claimSlot(table, keyWord);
+            if (!slot) {
+                return false;
+            }
+            if (slot->value.exchange(valueWord, memory_order_acq_rel) == Tombstone) {
+                count_.add(1);
+            }
+            return true;
+        });
+    }
+
+    bool remove(const Key& key) {
+        uint64_t keyWord = encode(key);
+        if (keyWord == EmptyKey) {
+            return false;
+        }
+        bool removed = false;
+        write([&](Table& table) {
+            // Cast away the const from the read-side helper: we hold the
+            // write gate.
+            Slot* slot = const_cast<Slot*>(findSlot(table, keyWord));
+            if (slot && slot->value.exchange(Tombstone, memory_order_acq_rel) != Tombstone) {
+                count_.subtract(1);
+                removed = true;
+            }
+            return true;
+        });
+        return removed;
+    }
+
+    // Exact once writers are quiet; see StripedCounter.
+    size_t size() const {
+        return count_.approximate();
+    }
+
+    void clear() {
+        write([&](Table& table) {
+            for (size_t i = 0; i < table.capacity; ++i) {
+                if (table.slots[i].value.exchange(Tombstone, memory_order_acq_rel) != Tombstone) {
+                    count_.subtract(1);
+                }
+            }
+            return true;
+        });
+    }
+};
+
+#endif // ATOMIC_FLAT_HASHMAP_HPP
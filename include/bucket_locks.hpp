@@ -0,0 +1,223 @@
+#ifndef BUCKET_LOCKS_HPP
+#define BUCKET_LOCKS_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Bucket lock types for Traits::BucketLock. Any type with the SharedMutex
+// interface works (lock/try_lock/unlock plus the _shared versions); these
+// are the ones that ship with the map. Bucket critical sections are a few
+// dozen nanoseconds, so all of them spin briefly before backing off.
+
+// Spin-wait helper: a CPU pause for the first few rounds, then give the core
+// away so a preempted lock holder can finish.
+class SpinBackoff {
+public:
+    void pause() {
+        if (spins_ < SpinLimit) {
+            ++spins_;
+#if defined(__SSE2__)
+            _mm_pause();
+#endif
+        } else {
+            this_thread::yield();
+        }
+    }
+
+    bool exhausted() const {
+        return spins_ >= SpinLimit;
+    }
+
+private:
+    static constexpr unsigned SpinLimit = 64;
+    unsigned spins_ = 0;
+};
+
+// Reader-writer lock state in one 32-bit word: bit 0 is the writer, bit 1
+// says a writer is waiting (new readers hold off so writers don't starve),
+// and the rest counts readers.
+class RWLockWord {
+protected:
+    static constexpr uint32_t Writer = 1;
+    static constexpr uint32_t WriterWaiting = 2;
+    static constexpr uint32_t Reader = 4;
+
+    bool tryAcquireWrite() {
+        uint32_t state = state_.load(memory_order_relaxed);
+        return (state & ~WriterWaiting) == 0 &&
+               state_.compare_exchange_strong(state, Writer, memory_order_acquire, memory_order_relaxed);
+    }
+
+    // Fails only while a writer holds or is waiting for the lock.
+    bool tryAcquireRead() {
+        uint32_t state = state_.load(memory_order_relaxed);
+        while (!(state & (Writer | WriterWaiting))) {
+            if (state_.compare_exchange_weak(state, state + Reader,
+                                             memory_order_acquire, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void announceWriter() {
+        if (!(state_.load(memory_order_relaxed) & WriterWaiting)) {
+            state_.fetch_or(WriterWaiting, memory_order_relaxed);
+        }
+    }
+
+    atomic<uint32_t> state_{0};
+};
+
+// 4-byte writer-preferring spin RW lock. Cheapest when critical sections are
+// short and threads rarely outnumber cores.
+class SpinRWLock : private RWLockWord {
+public:
+    void lock() {
+        for (SpinBackoff backoff; !tryAcquireWrite(); backoff.pause()) {
+            announceWriter();
+        }
+    }
+
+    bool try_lock() {
+        return tryAcquireWrite();
+    }
+
+    void unlock() {
+        state_.fetch_and(~Writer, memory_order_release);
+    }
+
+    void lock_shared() {
+        for (SpinBackoff backoff; !tryAcquireRead(); backoff.pause()) {
+        }
+    }
+
+    bool try_lock_shared() {
+        return tryAcquireRead();
+    }
+
+    void unlock_shared() {
+        state_.fetch_sub(Reader, memory_order_release);
+    }
+};
+
+// 4-byte FIFO ticket lock. Readers don't share it - lock_shared() takes a
+// ticket like everyone else - but nobody can be overtaken, which keeps tail
+// latency flat on write-heavy buckets.
+class TicketLock {
+public:
+    void lock() {
+        uint16_t ticket = next_.fetch_add(1, memory_order_relaxed);
+        for (SpinBackoff backoff; serving_.load(memory_order_acquire) != ticket; backoff.pause()) {
+        }
+    }
+
+    // Succeeds only if nobody holds or is queued for the lock.
+    bool try_lock() {
+        uint16_t serving = serving_.load(memory_order_acquire);
+        uint16_t expected = serving;
+        return next_.compare_exchange_strong(expected, static_cast<uint16_t>(serving + 1),
+                                             memory_order_acquire, memory_order_relaxed);
+    }
+
+    void unlock() {
+        serving_.store(static_cast<uint16_t>(serving_.load(memory_order_relaxed) + 1), memory_order_release);
+    }
+
+    void lock_shared() { lock(); }
+    bool try_lock_shared() { return try_lock(); }
+    void unlock_shared() { unlock(); }
+
+private:
+    atomic<uint16_t> next_{0};
+    atomic<uint16_t> serving_{0};
+};
+
+// 8-byte adaptive RW lock: spins like SpinRWLock for a while, then sleeps in
+// the kernel on the lock word (futex on Linux, yield elsewhere). Threads that
+// lose the race to a long critical section, or to a preempted holder, stop
+// burning the core.
+class FutexRWLock : private RWLockWord {
+public:
+    void lock() {
+        SpinBackoff backoff;
+        while (!tryAcquireWrite()) {
+            announceWriter();
+            if (backoff.exhausted()) {
+                sleepWhile(state_.load(memory_order_relaxed));
+            } else {
+                backoff.pause();
+            }
+        }
+    }
+
+    bool try_lock() {
+        return tryAcquireWrite();
+    }
+
+    void unlock() {
+        state_.fetch_and(~Writer, memory_order_seq_cst);
+        wakeSleepers();
+    }
+
+    void lock_shared() {
+        SpinBackoff backoff;
+        while (!tryAcquireRead()) {
+            if (backoff.exhausted()) {
+                sleepWhile(state_.load(memory_order_relaxed));
+            } else {
+                backoff.pause();
+            }
+        }
+    }
+
+    bool try_lock_shared() {
+        return tryAcquireRead();
+    }
+
+    void unlock_shared() {
+        state_.fetch_sub(Reader, memory_order_seq_cst);
+        wakeSleepers();
+    }
+
+private:
+    // Blocks until the lock word moves off `observed`. The sleeper count is
+    // raised before the kernel re-checks the word, and unlockers change the
+    // word before reading the count, so a wake-up can't fall in between.
+    void sleepWhile(uint32_t observed) {
+        sleepers_.fetch_add(1, memory_order_seq_cst);
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE,
+                observed, nullptr, nullptr, 0);
+#else
+        if (state_.load(memory_order_relaxed) == observed) {
+            this_thread::yield();
+        }
+#endif
+        sleepers_.fetch_sub(1, memory_order_relaxed);
+    }
+
+    void wakeSleepers() {
+        if (sleepers_.load(memory_order_seq_cst) > 0) {
+#if defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE,
+                    INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+    }
+
+    atomic<uint32_t> sleepers_{0};
+};
+
+#endif // BUCKET_LOCKS_HPP
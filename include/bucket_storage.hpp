@@ -0,0 +1,493 @@
+#ifndef BUCKET_STORAGE_HPP
+#define BUCKET_STORAGE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// How many entries a bucket keeps inline before it spills. Small entries get
+// enough slots to cover a typical chain; big ones keep at least one so the
+// common single-entry bucket never allocates.
+template<typename Key, typename Value>
+constexpr size_t defaultInlineSlots() {
+    constexpr size_t entry = sizeof(Key) + sizeof(Value);
+    return entry <= 16 ? 4 : (entry <= 64 ? 2 : 1);
+}
+
+// Outcome of a lock-free probe of a bucket's inline slots.
+enum class ProbeResult {
+    Found,
+    Absent,
+    Unknown  // inline slots are full and the key may be in the overflow block
+};
+
+// Default overflow block: entries in insertion order, scanned linearly. Fine
+// while a bucket only ever spills a handful of entries.
+//
+// Overflow blocks default-construct their Allocator (rebound to whatever they
+// store), so it has to be stateless, like std::allocator or PoolAllocator.
+template<typename Key, typename Value, typename Allocator = allocator<pair<const Key, Value>>>
+class FlatOverflow {
+    template<typename T>
+    using Rebind = typename allocator_traits<Allocator>::template rebind_alloc<T>;
+
+public:
+    using allocator_type = Allocator;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t size() const {
+        return keys_.size();
+    }
+
+    template<typename K, typename Eq>
+    size_t find(const K& key, const Eq& eq) const {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (eq(keys_[i], key)) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    // Non-const access is only for draining; changing a key in place would
+    // break HashedOverflow's index.
+    Key& key(size_t i) { return keys_[i]; }
+    const Key& key(size_t i) const { return keys_[i]; }
+    Value& value(size_t i) { return values_[i]; }
+    const Value& value(size_t i) const { return values_[i]; }
+
+    template<typename K, typename... Args>
+    size_t emplace(K&& key, Args&&... args) {
+        keys_.emplace_back(std::forward<K>(key));
+        try {
+            values_.emplace_back(std::forward<Args>(args)...);
+        } catch (...) {
+            keys_.pop_back();
+            throw;
+        }
+        return keys_.size() - 1;
+    }
+
+    // Removes entry i by moving the last entry into its place.
+    void erase(size_t i) {
+        if (i != keys_.size() - 1) {
+            keys_[i] = std::move(keys_.back());
+            values_[i] = std::move(values_.back());
+        }
+        keys_.pop_back();
+        values_.pop_back();
+    }
+
+    // Moves the last entry out into key/value and removes it.
+    void popBack(Key& key, Value& value) {
+        key = std::move(keys_.back());
+        value = std::move(values_.back());
+        keys_.pop_back();
+        values_.pop_back();
+    }
+
+private:
+    vector<Key, Rebind<Key>> keys_;
+    vector<Value, Rebind<Value>> values_;
+};
+
+// Overflow block that is a small hash table of its own: the same dense key and
+// value arrays as FlatOverflow, plus a linear-probing index over them that
+// doubles once it is 3/4 full. A hot bucket can hold thousands of entries and
+// still find one in a probe or two, and the growth only ever happens under
+// that bucket's lock.
+//
+// Hashes are recomputed here with a default-constructed Hash and mixed with a
+// Fibonacci multiply, taking the top bits, so the index is independent of the
+// bits the map used to pick the bucket.
+template<typename Key, typename Value, typename Hash,
+         typename Allocator = allocator<pair<const Key, Value>>>
+class HashedOverflow {
+    static_assert(is_default_constructible_v<Hash>,
+                  "hashed overflow blocks construct their own Hash");
+
+    template<typename T>
+    using Rebind = typename allocator_traits<Allocator>::template rebind_alloc<T>;
+
+public:
+    using allocator_type = Allocator;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HashedOverflow() {
+        rebuild(MinIndexSize);
+    }
+
+    size_t size() const {
+        return keys_.size();
+    }
+
+    template<typename K, typename Eq>
+    size_t find(const K& key, const Eq& eq) const {
+        size_t hash = hash_(key);
+        size_t mask = index_.size() - 1;
+        for (size_t s = home(hash);; s = (s + 1) & mask) {
+            uint32_t entry = index_[s];
+            if (entry == 0) {
+                return npos;
+            }
+            if (hashes_[entry - 1] == hash && eq(keys_[entry - 1], key)) {
+                return entry - 1;
+            }
+        }
+    }
+
+    Key& key(size_t i) { return keys_[i]; }
+    const Key& key(size_t i) const { return keys_[i]; }
+    Value& value(size_t i) { return values_[i]; }
+    const Value& value(size_t i) const { return values_[i]; }
+
+    template<typename K, typename... Args>
+    size_t emplace(K&& key, Args&&... args) {
+        hashes_.push_back(hash_(key));
+        try {
+            keys_.emplace_back(std::forward<K>(key));
+            try {
+                values_.emplace_back(std::forward<Args>(args)...);
+            } catch (...) {
+                keys_.pop_back();
+                throw;
+            }
+        } catch (...) {
+            hashes_.pop_back();
+            throw;
+        }
+
+        size_t i = keys_.size() - 1;
+        if (keys_.size() * 4 > index_.size() * 3) {
+            rebuild(index_.size() * 2);
+        } else {
+            link(i);
+        }
+        return i;
+    }
+
+    void erase(size_t i) {
+        unlink(locate(i));
+        size_t last = keys_.size() - 1;
+        if (i != last) {
+            size_t s = locate(last);
+            keys_[i] = std::move(keys_[last]);
+            values_[i] = std::move(values_[last]);
+            hashes_[i] = hashes_[last];
+            index_[s] = static_cast<uint32_t>(i + 1);
+        }
+        keys_.pop_back();
+        values_.pop_back();
+        hashes_.pop_back();
+    }
+
+    void popBack(Key& key, Value& value) {
+        unlink(locate(keys_.size() - 1));
+        key = std::move(keys_.back());
+        value = std::move(values_.back());
+        keys_.pop_back();
+        values_.pop_back();
+        hashes_.pop_back();
+    }
+
+private:
+    static constexpr size_t MinIndexSize = 8;
+
+    size_t home(size_t hash) const {
+        return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    // Index position that points at entry i.
+    size_t locate(size_t i) const {
+        size_t mask = index_.size() - 1;
+        size_t s = home(hashes_[i]);
+        while (index_[s] != i + 1) {
+            s = (s + 1) & mask;
+        }
+        return s;
+    }
+
+    void link(size_t i) {
+        size_t mask = index_.size() - 1;
+        size_t s = home(hashes_[i]);
+        while (index_[s] != 0) {
+            s = (s + 1) & mask;
+        }
+        index_[s] = static_cast<uint32_t>(i + 1);
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // gap so lookups never need tombstones.
+    void unlink(size_t s) {
+        size_t mask = index_.size() - 1;
+        index_[s] = 0;
+        for (size_t j = (s + 1) & mask; index_[j] != 0; j = (j + 1) & mask) {
+            size_t h = home(hashes_[index_[j] - 1]);
+            if (((j - h) & mask) >= ((j - s) & mask)) {
+                index_[s] = index_[j];
+                index_[j] = 0;
+                s = j;
+            }
+        }
+    }
+
+    void rebuild(size_t indexSize) {
+        index_.assign(indexSize, 0);
+        shift_ = 64;
+        for (size_t n = indexSize; n > 1; n >>= 1) {
+            --shift_;
+        }
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            link(i);
+        }
+    }
+
+    vector<Key, Rebind<Key>> keys_;
+    vector<Value, Rebind<Value>> values_;
+    vector<size_t, Rebind<size_t>> hashes_;
+    vector<uint32_t, Rebind<uint32_t>> index_;  // entry + 1, or 0 for an empty position
+    unsigned shift_ = 64;
+    Hash hash_;
+};
+
+// Entry storage for a single bucket.
+//
+// The first InlineSlots entries live inside the bucket, right next to its lock,
+// with keys and values in separate arrays so a lookup scans contiguous keys and
+// only touches the value it actually returns. Once the inline slots are full,
+// further entries go to an Overflow block (FlatOverflow or HashedOverflow).
+//
+// Entries are addressed by slot index: [0, InlineSlots) is inline, anything
+// above is in the overflow block. Erasing moves another entry into the hole,
+// so slot indices are only stable until the next erase.
+template<typename Key, typename Value, size_t InlineSlots = defaultInlineSlots<Key, Value>(),
+         typename Overflow = FlatOverflow<Key, Value>>
+class BucketStorage {
+    static_assert(InlineSlots > 0, "a bucket needs at least one inline slot");
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    BucketStorage() = default;
+    BucketStorage(const BucketStorage&) = delete;
+    BucketStorage& operator=(const BucketStorage&) = delete;
+
+    ~BucketStorage() {
+        clear();
+    }
+
+    size_t size() const {
+        return inlineCount_ + (overflow_ ? overflow_->size() : 0);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    template<typename K, typename Eq>
+    size_t find(const K& key, const Eq& eq) const {
+        for (size_t i = 0; i < inlineCount_; ++i) {
+            if (eq(inlineKey(i), key)) {
+                return i;
+            }
+        }
+        if (overflow_) {
+            size_t i = overflow_->find(key, eq);
+            if (i != Overflow::npos) {
+                return InlineSlots + i;
+            }
+        }
+        return npos;
+    }
+
+    // Seqlock read of the inline slots, done without the bucket lock. A writer
+    // may be halfway through changing the bucket, so everything is copied out
+    // byte-wise first and the result means nothing until the caller has
+    // re-checked the bucket's version. On Found the value's bytes are copied
+    // into valueOut unless it is null.
+    template<typename K, typename Eq>
+    ProbeResult probeInline(const K& key, const Eq& eq, void* valueOut) const {
+        static_assert(is_trivially_copyable_v<Key> && is_trivially_copyable_v<Value>,
+                      "optimistic reads need trivially copyable entries");
+
+        uint32_t count;
+        memcpy(&count, &inlineCount_, sizeof(count));
+        count = min<uint32_t>(count, InlineSlots);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            alignas(Key) unsigned char keyCopy[sizeof(Key)];
+            memcpy(keyCopy, keys_ + i * sizeof(Key), sizeof(Key));
+            if (eq(*std::launder(reinterpret_cast<const Key*>(keyCopy)), key)) {
+                if (valueOut) {
+                    memcpy(valueOut, values_ + i * sizeof(Value), sizeof(Value));
+                }
+                return ProbeResult::Found;
+            }
+        }
+        // Erase keeps the inline slots dense, so the overflow block can only
+        // hold entries when every inline slot is taken.
+        return count == InlineSlots ? ProbeResult::Unknown : ProbeResult::Absent;
+    }
+
+    const Key& key(size_t slot) const {
+        return slot < InlineSlots ? inlineKey(slot) : overflow_->key(slot - InlineSlots);
+    }
+
+    Value& value(size_t slot) {
+        return slot < InlineSlots ? inlineValue(slot) : overflow_->value(slot - InlineSlots);
+    }
+
+    const Value& value(size_t slot) const {
+        return slot < InlineSlots ? inlineValue(slot) : overflow_->value(slot - InlineSlots);
+    }
+
+    // Appends a new entry and returns its slot. The caller has already checked
+    // that the key is not present.
+    template<typename K, typename... Args>
+    size_t emplace(K&& key, Args&&... args) {
+        if (inlineCount_ < InlineSlots) {
+            size_t slot = inlineCount_;
+            ::new (static_cast<void*>(inlineKeyPtr(slot))) Key(std::forward<K>(key));
+            try {
+                ::new (static_cast<void*>(inlineValuePtr(slot))) Value(std::forward<Args>(args)...);
+            } catch (...) {
+                inlineKeyPtr(slot)->~Key();
+                throw;
+            }
+            ++inlineCount_;
+            return slot;
+        }
+
+        if (!overflow_) {
+            overflow_ = makeOverflow();
+        }
+        return InlineSlots + overflow_->emplace(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    void erase(size_t slot) {
+        if (overflow_ && overflow_->size() > 0) {
+            if (slot >= InlineSlots) {
+                overflow_->erase(slot - InlineSlots);
+            } else {
+                // Fill the hole from the overflow block so the inline slots
+                // stay dense.
+                overflow_->popBack(*inlineKeyPtr(slot), *inlineValuePtr(slot));
+            }
+            return;
+        }
+
+        size_t last = inlineCount_ - 1;
+        if (slot != last) {
+            *inlineKeyPtr(slot) = std::move(*inlineKeyPtr(last));
+            *inlineValuePtr(slot) = std::move(*inlineValuePtr(last));
+        }
+        inlineKeyPtr(last)->~Key();
+        inlineValuePtr(last)->~Value();
+        --inlineCount_;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < inlineCount_; ++i) {
+            inlineKeyPtr(i)->~Key();
+            inlineValuePtr(i)->~Value();
+        }
+        inlineCount_ = 0;
+        overflow_.reset();
+    }
+
+    // Hands every entry to fn(Key&&, Value&&) and leaves the bucket empty.
+    template<typename F>
+    void drain(F&& fn) {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) {
+            Key& k = i < InlineSlots ? *inlineKeyPtr(i) : overflow_->key(i - InlineSlots);
+            fn(std::move(k), std::move(value(i)));
+        }
+        clear();
+    }
+
+    template<typename F>
+    void forEach(F&& fn) {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) {
+            fn(key(i), value(i));
+        }
+    }
+
+    template<typename F>
+    void forEach(F&& fn) const {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) {
+            fn(key(i), value(i));
+        }
+    }
+
+private:
+    using OverflowAllocator =
+        typename allocator_traits<typename Overflow::allocator_type>::template rebind_alloc<Overflow>;
+    using OverflowTraits = allocator_traits<OverflowAllocator>;
+
+    struct OverflowDeleter {
+        void operator()(Overflow* overflow) const {
+            OverflowAllocator alloc;
+            OverflowTraits::destroy(alloc, overflow);
+            OverflowTraits::deallocate(alloc, overflow, 1);
+        }
+    };
+
+    static unique_ptr<Overflow, OverflowDeleter> makeOverflow() {
+        OverflowAllocator alloc;
+        Overflow* overflow = OverflowTraits::allocate(alloc, 1);
+        try {
+            OverflowTraits::construct(alloc, overflow);
+        } catch (...) {
+            OverflowTraits::deallocate(alloc, overflow, 1);
+            throw;
+        }
+        return unique_ptr<Overflow, OverflowDeleter>(overflow);
+    }
+
+    Key* inlineKeyPtr(size_t i) {
+        return std::launder(reinterpret_cast<Key*>(keys_) + i);
+    }
+
+    const Key* inlineKeyPtr(size_t i) const {
+        return std::launder(reinterpret_cast<const Key*>(keys_) + i);
+    }
+
+    Value* inlineValuePtr(size_t i) {
+        return std::launder(reinterpret_cast<Value*>(values_) + i);
+    }
+
+    const Value* inlineValuePtr(size_t i) const {
+        return std::launder(reinterpret_cast<const Value*>(values_) + i);
+    }
+
+    const Key& inlineKey(size_t i) const {
+        return *inlineKeyPtr(i);
+    }
+
+    Value& inlineValue(size_t i) {
+        return *inlineValuePtr(i);
+    }
+
+    const Value& inlineValue(size_t i) const {
+        return *inlineValuePtr(i);
+    }
+
+    uint32_t inlineCount_ = 0;
+    alignas(Key) unsigned char keys_[sizeof(Key) * InlineSlots];
+    alignas(Value) unsigned char values_[sizeof(Value) * InlineSlots];
+    unique_ptr<Overflow, OverflowDeleter> overflow_;
+};
+
+#endif // BUCKET_STORAGE_HPP
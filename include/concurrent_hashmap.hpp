@@ -1,100 +1,1291 @@
 #ifndef CONCURRENT_HASHMAP_HPP
 #define CONCURRENT_HASHMAP_HPP
 
-#include <array>
-#include <list>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <functional>
 #include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bucket_locks.hpp"
+#include "bucket_storage.hpp"
+#include "hot_keys.hpp"
+#include "map_stats.hpp"
+#include "map_traits.hpp"
+#include "striped_counter.hpp"
+#include "thread_pool.hpp"
+#include "string_hash.hpp"
 using namespace std;
 
-template<typename Key,typename Value, size_t NumBuckets = 1024>
+// How a batched write (multi_put, apply_deltas) is made visible.
+enum class BatchMode {
+    // Each bucket's share of the batch is applied under one lock acquisition,
+    // but other threads can see the batch half-applied across buckets.
+    PerBucket,
+    // Every bucket the batch touches is locked, in index order, before
+    // anything is written; nobody sees part of the batch.
+    Atomic
+};
+
+// NumBuckets is the initial bucket count. The table doubles online once the
+// load factor passes MaxLoadFactor; see docs/architecture.md for how buckets
+// are migrated while readers and writers keep running. Traits holds the
+// layout and indexing knobs; see map_traits.hpp. With
+// Traits::SegmentedBuckets the table stays at NumBuckets and each bucket
+// grows its own overflow table instead.
+//
+// Allocator is used for the bucket arrays and for the overflow blocks
+// buckets spill into, which is where the per-entry allocations happen. It
+// is default-constructed wherever it is needed, so it must be stateless -
+// PoolAllocator and NumaAllocator (pool_allocator.hpp) are.
+template<typename Key, typename Value, size_t NumBuckets = 1024,
+         typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key>,
+         typename Traits = DefaultMapTraits,
+         typename Allocator = allocator<pair<const Key, Value>>>
 class ConcurrentHashMap {
 private:
+    static_assert(NumBuckets > 0, "NumBuckets must be at least 1");
+
+    // The Fibonacci index masks, so it only applies to power-of-two tables;
+    // any other NumBuckets keeps the modulo path. Growth doubles, so the
+    // choice holds for every table.
+    static constexpr bool FibonacciIndex =
+        Traits::FibonacciIndexing && (NumBuckets & (NumBuckets - 1)) == 0;
+
+    static constexpr double MaxLoadFactor = 1.0;
+    static constexpr size_t MigrationChunk = 16;
+
+    // Inserts only sum the striped counter against the resize threshold when
+    // their stripe crosses a multiple of this, or while the table is small
+    // enough that the stripes could hide a whole table's worth of entries.
+    static constexpr size_t ResizeCheckInterval = 16;
+    static constexpr size_t ResizeCheckAlwaysBelow = StripedCounter::Stripes * ResizeCheckInterval;
+
+    // size() gives up on a stable counter snapshot after this many tries and
+    // counts the buckets instead.
+    static constexpr int MaxSizeSnapshotAttempts = 4;
+
+    // Parallel traversals cut range_count() into this many chunks per pool
+    // thread, so stealing can even out buckets of uneven size.
+    static constexpr size_t ParallelChunksPerThread = 4;
+
+    // Plain-old-data entries are read with a seqlock instead of the shared
+    // lock; after this many interrupted attempts the reader takes the lock.
+    static constexpr bool OptimisticReads =
+        is_trivially_copyable_v<Key> && is_trivially_copyable_v<Value>;
+    static constexpr int MaxOptimisticAttempts = 4;
+
+    // Writers bump the bucket version for seqlock readers and for hot-key
+    // replicas, which use it to tell whether their copy is stale.
+    static constexpr bool VersionedBuckets = OptimisticReads || Traits::HotKeyReplicas;
+
+    // multi_get sorts a batch by bucket once it has at least one key per
+    // this many buckets, and otherwise prefetches this far ahead.
+    static constexpr size_t MultiGetDenseRatio = 4;
+    static constexpr size_t MultiGetPrefetchDistance = 8;
+
+    // With SegmentedBuckets each bucket spills into its own growable hash
+    // table instead of a flat overflow block.
+    using Overflow = conditional_t<Traits::SegmentedBuckets,
+                                   HashedOverflow<Key, Value, Hash, Allocator>,
+                                   FlatOverflow<Key, Value, Allocator>>;
+
+    using BucketLock = typename Traits::BucketLock;
+
+    // Flat combining: a combined write posts one of these to its bucket and
+    // waits; whoever holds the bucket lock runs it. It lives on the poster's
+    // stack, which is fine since the poster can't return before it's run.
+    struct Bucket;
+    struct CombineRequest {
+        enum State { Pending, Done, Retry };
+
+        CombineRequest(void (*fn)(void*, Bucket&), void* ctx) : apply(fn), context(ctx) {}
+
+        void (*apply)(void* context, Bucket& bucket);
+        void* context;
+        CombineRequest* next = nullptr;
+        atomic<int> state{Pending};
+        exception_ptr error;
+    };
+    struct NoPending {};
+
+    // Rounds of newly posted requests a combiner takes on before it lets go
+    // of the lock, so one thread can't be kept combining forever.
+    static constexpr int MaxCombineRounds = 8;
+
     struct Bucket {
-        mutable shared_mutex mutex;
-        list<pair<Key,Value>> items;
+        mutable BucketLock mutex;
+        atomic<uint32_t> version{0};  // odd while a writer holds the bucket
+        atomic<bool> moved{false};    // entries now live in the next table
+        BucketStorage<Key, Value, defaultInlineSlots<Key, Value>(), Overflow> items;
+        conditional_t<Traits::FlatCombining, atomic<CombineRequest*>, NoPending> pending{};
+    };
+
+    struct alignas(Traits::AlignBuckets ? CacheLineSize : alignof(Bucket)) AlignedBucket : Bucket {};
+
+    using Stats = conditional_t<Traits::CollectStats, StatsCollector, NoStats>;
+
+    // Takes a bucket lock. With stats on it tries first, so uncontended
+    // acquisitions cost nothing extra, and only times the ones that block.
+    template<typename L>
+    static void acquire(L& lock, Stats& stats) {
+        if constexpr (Traits::CollectStats) {
+            if (lock.try_lock()) {
+                stats.recordLock();
+                return;
+            }
+            auto start = chrono::steady_clock::now();
+            lock.lock();
+            auto waited = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+            stats.recordContendedLock(static_cast<uint64_t>(waited.count()));
+        } else {
+            (void)stats;
+            lock.lock();
+        }
+    }
+
+    class ReadLock {
+    public:
+        ReadLock(Bucket& bucket, Stats& stats) : lock_(bucket.mutex, defer_lock) {
+            acquire(lock_, stats);
+        }
+
+    private:
+        shared_lock<BucketLock> lock_;
+    };
+
+    // Exclusive bucket lock. For seqlock-readable maps it also bumps the
+    // bucket version around the critical section so optimistic readers can
+    // tell their copy was torn, and hot-key replicas that theirs is stale.
+    class WriteLock {
+    public:
+        WriteLock(Bucket& bucket, Stats& stats) : bucket_(bucket), lock_(bucket.mutex, defer_lock) {
+            acquire(lock_, stats);
+            beginWrite();
+        }
+
+        // Takes over a lock the caller already acquired.
+        WriteLock(Bucket& bucket, adopt_lock_t) : bucket_(bucket), lock_(bucket.mutex, adopt_lock) {
+            beginWrite();
+        }
+
+        ~WriteLock() {
+            if constexpr (VersionedBuckets) {
+                bucket_.version.store(bucket_.version.load(memory_order_relaxed) + 1, memory_order_release);
+            }
+        }
+
+    private:
+        void beginWrite() {
+            if constexpr (VersionedBuckets) {
+                bucket_.version.store(bucket_.version.load(memory_order_relaxed) + 1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_release);
+            }
+        }
+
+        Bucket& bucket_;
+        unique_lock<BucketLock> lock_;
+    };
+
+    using BucketAllocator = typename allocator_traits<Allocator>::template rebind_alloc<AlignedBucket>;
+    using BucketTraits = allocator_traits<BucketAllocator>;
+
+    struct BucketArrayDeleter {
+        size_t count;
+
+        void operator()(AlignedBucket* buckets) const {
+            BucketAllocator alloc;
+            for (size_t i = count; i > 0; --i) {
+                BucketTraits::destroy(alloc, buckets + i - 1);
+            }
+            BucketTraits::deallocate(alloc, buckets, count);
+        }
     };
 
-    array<Bucket,NumBuckets> buckets_;
+    using BucketArray = unique_ptr<AlignedBucket[], BucketArrayDeleter>;
 
-    size_t getBucketIndex(cont Key& key) const {
-        return hash<Key>{}(key) % NumBuckets;
+    static BucketArray makeBuckets(size_t n) {
+        BucketAllocator alloc;
+        AlignedBucket* buckets = BucketTraits::allocate(alloc, n);
+        size_t built = 0;
+        try {
+            for (; built < n; ++built) {
+                BucketTraits::construct(alloc, buckets + built);
+            }
+        } catch (...) {
+            while (built > 0) {
+                BucketTraits::destroy(alloc, buckets + --built);
+            }
+            BucketTraits::deallocate(alloc, buckets, n);
+            throw;
+        }
+        return BucketArray(buckets, BucketArrayDeleter{n});
     }
 
-    Bucket& getBucket(const Key& key){
-        return buckets_[getBucketIndex(key)];
+    struct Table {
+        explicit Table(size_t n) : size(n), buckets(makeBuckets(n)) {}
+
+        const size_t size;
+        BucketArray buckets;
+
+        // Resize bookkeeping. `next` is published before the first bucket is
+        // marked moved, so anyone who finds a moved bucket can follow it.
+        atomic<bool> resizeClaimed{false};
+        atomic<Table*> next{nullptr};
+        atomic<size_t> transferIndex{0};
+        atomic<size_t> migrated{0};
+
+        // Superseded tables stay alive until the map is destroyed, since a
+        // reader may still be looking at them. Growth is geometric, so they
+        // never add up to more than the live table.
+        unique_ptr<Table> previous;
+    };
+
+    atomic<Table*> table_;
+    StripedCounter count_;
+    mutable Stats stats_;
+    mutable conditional_t<Traits::HotKeyReplicas, HotKeyCache<Key, Value>, NoHotKeys> hotKeys_;
+    Hash hash_;
+    KeyEqual equal_;
+
+    // Heterogeneous lookup is on when both functors declare is_transparent,
+    // as with std::unordered_map in C++20.
+    template<typename T, typename = void>
+    struct HasTransparentTag : false_type {};
+
+    template<typename T>
+    struct HasTransparentTag<T, void_t<typename T::is_transparent>> : true_type {};
+
+    template<typename K>
+    static constexpr bool IsLookupKey =
+        HasTransparentTag<Hash>::value && HasTransparentTag<KeyEqual>::value &&
+        !is_same_v<decay_t<K>, Key>;
+
+    template<typename K>
+    size_t hashKey(const K& key) const {
+        return hash_(key);
     }
 
-    const Bucket& getBucket(const Key& key) const{
-        return buckets_[getBucketIndex(key)];
+    // Table sizes only ever double, so both schemes split bucket i into
+    // i and i + size on growth.
+    static size_t getBucketIndex(size_t hash, size_t tableSize) {
+        if constexpr (FibonacciIndex) {
+            // The multiply only carries upwards, so fold the high half back
+            // down before masking or the low bits would ignore most of the key.
+            uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(mixed ^ (mixed >> 32)) & (tableSize - 1);
+        } else {
+            return hash % tableSize;
+        }
+    }
+
+    // Locks the bucket that currently owns `hash` and runs fn(bucket) under
+    // the lock. Buckets that have been migrated are skipped by following the
+    // table chain forward, so callers always land on live data.
+    template<typename Lock, typename F>
+    decltype(auto) withBucket(size_t hash, F&& fn) const {
+        Table* table = table_.load(memory_order_acquire);
+        for (;;) {
+            Bucket& bucket = table->buckets[getBucketIndex(hash, table->size)];
+            Lock lock(bucket, stats_);
+            if (!bucket.moved.load(memory_order_relaxed)) {
+                return fn(bucket);
+            }
+            table = table->next.load(memory_order_acquire);
+        }
+    }
+
+    // withBucket<WriteLock> for the combinable writes (put, merge and the
+    // compute family).
+    // With Traits::FlatCombining, fn is posted to the bucket instead, and
+    // runs on whichever thread wins the lock, along with everything else
+    // posted to that bucket by then - one lock handoff for a whole queue of
+    // writers to a hot key.
+    template<typename F>
+    decltype(auto) writeBucket(size_t hash, F&& fn) {
+        if constexpr (!Traits::FlatCombining) {
+            return withBucket<WriteLock>(hash, fn);
+        } else {
+            using Result = decltype(fn(declval<Bucket&>()));
+            optional<Result> result;
+            auto run = [&](Bucket& bucket) { result.emplace(fn(bucket)); };
+
+            Table* table = table_.load(memory_order_acquire);
+            for (;;) {
+                Bucket& bucket = table->buckets[getBucketIndex(hash, table->size)];
+                CombineRequest request([](void* context, Bucket& b) {
+                    (*static_cast<decltype(run)*>(context))(b);
+                }, &run);
+                if (postAndWait(bucket, request)) {
+                    if (request.error) {
+                        rethrow_exception(request.error);
+                    }
+                    return Result(std::move(*result));
+                }
+                // The bucket was migrated; the combiner that told us so saw
+                // `next` published, and so do we.
+                table = table->next.load(memory_order_acquire);
+            }
+        }
+    }
+
+    // Returns false if the request has to be retried on the next table.
+    bool postAndWait(Bucket& bucket, CombineRequest& request) {
+        CombineRequest* head = bucket.pending.load(memory_order_relaxed);
+        do {
+            request.next = head;
+        } while (!bucket.pending.compare_exchange_weak(head, &request, memory_order_release,
+                                                       memory_order_relaxed));
+
+        for (SpinBackoff backoff;; backoff.pause()) {
+            int state = request.state.load(memory_order_acquire);
+            if (state != CombineRequest::Pending) {
+                return state == CombineRequest::Done;
+            }
+            if (bucket.mutex.try_lock()) {
+                if constexpr (Traits::CollectStats) {
+                    stats_.recordLock();
+                }
+                WriteLock lock(bucket, adopt_lock);
+                combine(bucket);
+            } else if (backoff.exhausted()) {
+                // try_lock never announces a waiting writer, so a steady run
+                // of readers could keep us out for good. Queue for the lock
+                // like any other writer instead. By the time we hold it our
+                // request is done, either by the last holder or by us here.
+                acquire(bucket.mutex, stats_);
+                WriteLock lock(bucket, adopt_lock);
+                combine(bucket);
+            }
+        }
+    }
+
+    // Caller holds the bucket's write lock. Runs every posted request in
+    // posting order, or sends them all back if the bucket has moved.
+    void combine(Bucket& bucket) {
+        bool moved = bucket.moved.load(memory_order_relaxed);
+        for (int round = 0; round < MaxCombineRounds; ++round) {
+            CombineRequest* posted = bucket.pending.exchange(nullptr, memory_order_acquire);
+            if (!posted) {
+                return;
+            }
+            CombineRequest* ordered = nullptr;
+            while (posted) {
+                CombineRequest* next = posted->next;
+                posted->next = ordered;
+                ordered = posted;
+                posted = next;
+            }
+            while (ordered) {
+                // Read the link first: the poster may return, taking the
+                // request with it, as soon as it is marked finished.
+                CombineRequest* request = ordered;
+                ordered = request->next;
+                if (moved) {
+                    request->state.store(CombineRequest::Retry, memory_order_release);
+                    continue;
+                }
+                try {
+                    request->apply(request->context, bucket);
+                } catch (...) {
+                    request->error = current_exception();
+                }
+                request->state.store(CombineRequest::Done, memory_order_release);
+            }
+        }
+    }
+
+    // Visits every live bucket once, wherever its entries currently are.
+    template<typename Lock, typename F>
+    void forEachBucket(F&& fn) const {
+        Table* table = table_.load(memory_order_acquire);
+        for (size_t i = 0; i < table->size; ++i) {
+            visitBucket<Lock>(table, i, fn);
+        }
+    }
+
+    // Visits the live buckets holding top-level slots [first, last) of the
+    // initial NumBuckets table. Every table size is NumBuckets times a power
+    // of two and a bucket only ever splits into i and i + size, so slot i owns
+    // exactly the buckets j with j % NumBuckets == i, in any table.
+    template<typename Lock, typename F>
+    void forEachBucketInRange(size_t first, size_t last, F&& fn) const {
+        last = min(last, NumBuckets);
+        Table* table = table_.load(memory_order_acquire);
+        // Walk each NumBuckets-sized block in order rather than striding, so
+        // the bucket array is read sequentially.
+        for (size_t block = 0; block < table->size; block += NumBuckets) {
+            for (size_t i = first; i < last; ++i) {
+                visitBucket<Lock>(table, block + i, fn);
+            }
+        }
+    }
+
+    template<typename Lock, typename F>
+    void visitBucket(Table* table, size_t index, F& fn) const {
+        Bucket& bucket = table->buckets[index];
+        {
+            Lock lock(bucket, stats_);
+            if (!bucket.moved.load(memory_order_relaxed)) {
+                fn(bucket);
+                return;
+            }
+        }
+        // A moved bucket split into `index` and `index + size` of the next
+        // table; nothing else can have landed there.
+        Table* next = table->next.load(memory_order_acquire);
+        visitBucket<Lock>(next, index, fn);
+        visitBucket<Lock>(next, index + table->size, fn);
+    }
+
+    void onInserted(size_t inserted = 1) {
+        auto [before, after] = count_.add(inserted);
+        if constexpr (Traits::SegmentedBuckets) {
+            return;  // buckets grow on their own, the table never does
+        }
+        Table* table = table_.load(memory_order_acquire);
+        bool sample = table->size < ResizeCheckAlwaysBelow ||
+                      before / ResizeCheckInterval != after / ResizeCheckInterval;
+        if (sample && !table->resizeClaimed.load(memory_order_relaxed) &&
+            count_.approximate() > table->size * MaxLoadFactor &&
+            !table->resizeClaimed.exchange(true, memory_order_acq_rel)) {
+            table->next.store(new Table(table->size * 2), memory_order_release);
+        }
+        helpResize();
+    }
+
+    void countOp(StatOp op) const {
+        if constexpr (Traits::CollectStats) {
+            stats_.recordOp(op);
+        }
+    }
+
+    static size_t parallelChunkSize(const ThreadPool& pool) {
+        size_t chunks = (pool.thread_count() + 1) * ParallelChunksPerThread;
+        return max<size_t>(NumBuckets / chunks, 1);
+    }
+
+    void applyCountDelta(int delta) {
+        if (delta > 0) {
+            onInserted();
+        } else if (delta < 0) {
+            count_.subtract(1);
+        }
+    }
+
+    // Migrates one chunk of buckets if a resize is in progress. Called by
+    // writers outside of any bucket lock; readers never help.
+    void helpResize() {
+        Table* table = table_.load(memory_order_acquire);
+        Table* next = table->next.load(memory_order_acquire);
+        if (!next) {
+            return;
+        }
+
+        size_t start = table->transferIndex.fetch_add(MigrationChunk, memory_order_relaxed);
+        if (start >= table->size) {
+            return;
+        }
+        size_t end = min(start + MigrationChunk, table->size);
+        for (size_t i = start; i < end; ++i) {
+            migrateBucket(table, next, i);
+        }
+
+        size_t done = end - start;
+        if (table->migrated.fetch_add(done, memory_order_acq_rel) + done == table->size) {
+            next->previous.reset(table);
+            table_.store(next, memory_order_release);
+        }
+    }
+
+    void migrateBucket(Table* table, Table* next, size_t index) {
+        Bucket& bucket = table->buckets[index];
+        WriteLock lock(bucket, stats_);
+        bucket.items.drain([&](Key&& k, Value&& v) {
+            Bucket& target = next->buckets[getBucketIndex(hashKey(k), next->size)];
+            WriteLock targetLock(target, stats_);
+            target.items.emplace(std::move(k), std::move(v));
+        });
+        bucket.moved.store(true, memory_order_relaxed);
+    }
+
+    // Seqlock lookup: copy the entry out without writing to the bucket, then
+    // make sure no writer ran in between. Unknown means the caller has to
+    // fall back to the locked path. valueOut may be null for a presence check.
+    template<typename K>
+    ProbeResult tryOptimisticFind(size_t hash, const K& key, void* valueOut) const {
+        Table* table = table_.load(memory_order_acquire);
+        for (int attempt = 0; attempt < MaxOptimisticAttempts;) {
+            const Bucket& bucket = table->buckets[getBucketIndex(hash, table->size)];
+            uint32_t before = bucket.version.load(memory_order_acquire);
+            if (before & 1) {
+                ++attempt;
+                continue;
+            }
+
+            ProbeResult probe = bucket.items.probeInline(key, equal_, valueOut);
+            bool moved = bucket.moved.load(memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+            if (bucket.version.load(memory_order_relaxed) != before) {
+                ++attempt;
+                continue;
+            }
+            if (moved) {
+                table = table->next.load(memory_order_acquire);
+                continue;
+            }
+            return probe;
+        }
+        return ProbeResult::Unknown;
+    }
+
+    // With Traits::HotKeyReplicas: if `key` is hot, serves it from the
+    // calling thread's replica - refilled under the bucket's read lock when a
+    // write has made it stale - and returns true. Otherwise samples the
+    // lookup for hot-key detection and returns false.
+    template<typename K>
+    bool lookupHot(const K& key, size_t hash, optional<Value>& value) const {
+        using Cache = HotKeyCache<Key, Value>;
+        if (!hotKeys_.empty()) {
+            EpochReclaimer::Guard guard;
+            if (typename Cache::Entry* entry = hotKeys_.find(key, hash, equal_)) {
+                if (!Cache::read(*entry, value)) {
+                    value = withBucket<ReadLock>(hash, [&](const Bucket& bucket) {
+                        optional<Value> found;
+                        size_t slot = bucket.items.find(key, equal_);
+                        if (slot != bucket.items.npos) {
+                            found = bucket.items.value(slot);
+                        }
+                        Cache::fill(*entry, bucket.version, found);
+                        return found;
+                    });
+                }
+                return true;
+            }
+        }
+        if (hotKeys_.sample()) {
+            hotKeys_.record(key, hash, equal_);
+        }
+        return false;
+    }
+
+    template<typename K>
+    optional<Value> getImpl(const K& key) const {
+        countOp(StatOp::Get);
+        size_t hash = hashKey(key);
+        if constexpr (Traits::HotKeyReplicas) {
+            optional<Value> value;
+            if (lookupHot(key, hash, value)) {
+                return value;
+            }
+        }
+        if constexpr (OptimisticReads) {
+            alignas(Value) unsigned char value[sizeof(Value)];
+            ProbeResult probe = tryOptimisticFind(hash, key, value);
+            if (probe == ProbeResult::Found) {
+                return *std::launder(reinterpret_cast<const Value*>(value));
+            }
+            if (probe == ProbeResult::Absent) {
+                return nullopt;
+            }
+        }
+        return withBucket<ReadLock>(hash, [&](const Bucket& bucket) -> optional<Value> {
+            size_t slot = bucket.items.find(key, equal_);
+            if (slot != bucket.items.npos) {
+                return bucket.items.value(slot);
+            }
+            return nullopt;
+        });
+    }
+
+    template<typename K>
+    bool containsImpl(const K& key) const {
+        countOp(StatOp::Contains);
+        size_t hash = hashKey(key);
+        if constexpr (Traits::HotKeyReplicas) {
+            optional<Value> value;
+            if (lookupHot(key, hash, value)) {
+                return value.has_value();
+            }
+        }
+        if constexpr (OptimisticReads) {
+            ProbeResult probe = tryOptimisticFind(hash, key, nullptr);
+            if (probe != ProbeResult::Unknown) {
+                return probe == ProbeResult::Found;
+            }
+        }
+        return withBucket<ReadLock>(hash, [&](const Bucket& bucket) {
+            return bucket.items.find(key, equal_) != bucket.items.npos;
+        });
+    }
+
+    template<typename K, typename F>
+    bool visitImpl(const K& key, F&& fn) const {
+        countOp(StatOp::Visit);
+        return withBucket<ReadLock>(hashKey(key), [&](const Bucket& bucket) {
+            size_t slot = bucket.items.find(key, equal_);
+            if (slot == bucket.items.npos) {
+                return false;
+            }
+            fn(bucket.items.value(slot));
+            return true;
+        });
+    }
+
+    // Batched lookup. Every key is hashed up front. Keys the seqlock can
+    // settle never touch a lock. The rest are looked up with each bucket's
+    // shared lock taken once for all of its keys: a dense batch is sorted by
+    // bucket, while in a sparse one few keys share a bucket and sorting would
+    // cost more than it saves, so those go in input order. Either way the
+    // buckets a few steps ahead are prefetched. fn(index into keys,
+    // const Value* or null) runs under the bucket lock unless the seqlock
+    // answered.
+    template<typename F>
+    void multiGetImpl(const Key* keys, size_t count, F& fn) const {
+        countOp(StatOp::MultiGet);
+        struct Pending {
+            size_t bucket;
+            size_t index;
+            size_t hash;
+
+            bool operator<(const Pending& other) const {
+                return bucket != other.bucket ? bucket < other.bucket : index < other.index;
+            }
+        };
+
+        Table* table = table_.load(memory_order_acquire);
+        vector<Pending> pending;
+        pending.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t hash = hashKey(keys[i]);
+            if constexpr (OptimisticReads) {
+                alignas(Value) unsigned char value[sizeof(Value)];
+                ProbeResult probe = tryOptimisticFind(hash, keys[i], value);
+                if (probe != ProbeResult::Unknown) {
+                    fn(i, probe == ProbeResult::Found ? std::launder(reinterpret_cast<const Value*>(value)) : nullptr);
+                    continue;
+                }
+            }
+            pending.push_back({getBucketIndex(hash, table->size), i, hash});
+        }
+        if (pending.size() * MultiGetDenseRatio >= table->size) {
+            sort(pending.begin(), pending.end());
+        }
+
+        for (size_t begin = 0; begin < pending.size();) {
+            size_t end = begin + 1;
+            while (end < pending.size() && pending[end].bucket == pending[begin].bucket) {
+                ++end;
+            }
+            if (end + MultiGetPrefetchDistance <= pending.size()) {
+                __builtin_prefetch(&table->buckets[pending[end + MultiGetPrefetchDistance - 1].bucket]);
+            }
+
+            Bucket& bucket = table->buckets[pending[begin].bucket];
+            bool moved;
+            {
+                ReadLock lock(bucket, stats_);
+                moved = bucket.moved.load(memory_order_relaxed);
+                if (!moved) {
+                    for (size_t k = begin; k < end; ++k) {
+                        size_t index = pending[k].index;
+                        size_t slot = bucket.items.find(keys[index], equal_);
+                        fn(index, slot != bucket.items.npos ? &bucket.items.value(slot) : nullptr);
+                    }
+                }
+            }
+            if (moved) {
+                // A resize got to this bucket first; its keys are now spread
+                // over the next table, so look them up one at a time.
+                for (size_t k = begin; k < end; ++k) {
+                    size_t index = pending[k].index;
+                    withBucket<ReadLock>(pending[k].hash, [&](const Bucket& b) {
+                        size_t slot = b.items.find(keys[index], equal_);
+                        fn(index, slot != b.items.npos ? &b.items.value(slot) : nullptr);
+                    });
+                }
+            }
+            begin = end;
+        }
+    }
+
+    // Batched write. Entries are grouped by bucket (input order is kept
+    // within a bucket, so later duplicates win) and apply(bucket, entry),
+    // which returns whether it inserted, runs for each one under the bucket's
+    // exclusive lock. Locks are always taken in ascending bucket index, which
+    // keeps concurrent batches deadlock-free.
+    template<typename Entry, typename Apply>
+    void batchWrite(const Entry* entries, size_t count, BatchMode mode, Apply& apply) {
+        countOp(StatOp::MultiWrite);
+        struct Pending {
+            size_t bucket;
+            size_t index;
+            size_t hash;
+
+            bool operator<(const Pending& other) const {
+                return bucket != other.bucket ? bucket < other.bucket : index < other.index;
+            }
+        };
+
+        vector<size_t> hashes(count);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashKey(entries[i].first);
+        }
+
+        size_t inserted = 0;
+        for (bool done = false; !done;) {
+            helpResize();
+            if (mode == BatchMode::Atomic) {
+                // Holding several old-table buckets while a resize moves
+                // them would never end, so let any migration finish first.
+                while (table_.load(memory_order_acquire)->next.load(memory_order_acquire)) {
+                    helpResize();
+                }
+            }
+
+            Table* table = table_.load(memory_order_acquire);
+            vector<Pending> pending(count);
+            for (size_t i = 0; i < count; ++i) {
+                pending[i] = {getBucketIndex(hashes[i], table->size), i, hashes[i]};
+            }
+            sort(pending.begin(), pending.end());
+
+            if (mode == BatchMode::PerBucket) {
+                for (size_t begin = 0; begin < count;) {
+                    size_t end = begin + 1;
+                    while (end < count && pending[end].bucket == pending[begin].bucket) {
+                        ++end;
+                    }
+                    Bucket& bucket = table->buckets[pending[begin].bucket];
+                    bool moved;
+                    {
+                        WriteLock lock(bucket, stats_);
+                        moved = bucket.moved.load(memory_order_relaxed);
+                        if (!moved) {
+                            for (size_t k = begin; k < end; ++k) {
+                                inserted += apply(bucket, entries[pending[k].index]);
+                            }
+                        }
+                    }
+                    if (moved) {
+                        for (size_t k = begin; k < end; ++k) {
+                            const Entry& entry = entries[pending[k].index];
+                            inserted += withBucket<WriteLock>(pending[k].hash, [&](Bucket& b) {
+                                return apply(b, entry);
+                            });
+                        }
+                    }
+                    begin = end;
+                }
+                done = true;
+            } else {
+                deque<WriteLock> locks;
+                bool moved = false;
+                for (size_t k = 0; k < count && !moved; ++k) {
+                    if (k > 0 && pending[k].bucket == pending[k - 1].bucket) {
+                        continue;
+                    }
+                    Bucket& bucket = table->buckets[pending[k].bucket];
+                    locks.emplace_back(bucket, stats_);
+                    moved = bucket.moved.load(memory_order_relaxed);
+                }
+                if (!moved) {
+                    for (size_t k = 0; k < count; ++k) {
+                        Bucket& bucket = table->buckets[pending[k].bucket];
+                        inserted += apply(bucket, entries[pending[k].index]);
+                    }
+                    done = true;
+                }
+                // Otherwise a new resize started while we were locking; drop
+                // everything and go again on the new table.
+            }
+        }
+        if (inserted > 0) {
+            onInserted(inserted);
+        }
+    }
+
+    // Shared by put and insert_or_assign. Unless the caller handed us a Value
+    // rvalue, a non-trivial value is copied or converted into a temporary
+    // before the lock is taken, so the critical section only has to move it.
+    template<typename K, typename V>
+    bool insertOrAssignImpl(K&& key, V&& value) {
+        if constexpr (!is_trivially_copyable_v<Value> &&
+                      !(is_same_v<decay_t<V>, Value> && !is_lvalue_reference_v<V>)) {
+            Value prepared(std::forward<V>(value));
+            return insertOrAssignImpl(std::forward<K>(key), std::move(prepared));
+        } else {
+            countOp(StatOp::Insert);
+            helpResize();
+            bool inserted = writeBucket(hashKey(key), [&](Bucket& bucket) {
+                size_t slot = bucket.items.find(key, equal_);
+                if (slot != bucket.items.npos) {
+                    bucket.items.value(slot) = std::forward<V>(value);
+                    return false;
+                }
+                bucket.items.emplace(std::forward<K>(key), std::forward<V>(value));
+                return true;
+            });
+            if (inserted) {
+                onInserted();
+            }
+            return inserted;
+        }
+    }
+
+    template<typename K, typename... Args>
+    bool tryEmplaceImpl(K&& key, Args&&... args) {
+        countOp(StatOp::Insert);
+        helpResize();
+        bool inserted = withBucket<WriteLock>(hashKey(key), [&](Bucket& bucket) {
+            if (bucket.items.find(key, equal_) != bucket.items.npos) {
+                return false;
+            }
+            bucket.items.emplace(std::forward<K>(key), std::forward<Args>(args)...);
+            return true;
+        });
+        if (inserted) {
+            onInserted();
+        }
+        return inserted;
+    }
+
+    template<typename K>
+    bool removeImpl(const K& key) {
+        countOp(StatOp::Remove);
+        helpResize();
+        bool removed = withBucket<WriteLock>(hashKey(key), [&](Bucket& bucket) {
+            size_t slot = bucket.items.find(key, equal_);
+            if (slot != bucket.items.npos) {
+                bucket.items.erase(slot);
+                return true;
+            }
+            return false;
+        });
+        if (removed) {
+            count_.subtract(1);
+        }
+        return removed;
     }
 
 public:
-    ConcurrentHashMap() = default;
+    explicit ConcurrentHashMap(const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : table_(new Table(NumBuckets)), hash_(hash), equal_(equal) {}
+
+    ~ConcurrentHashMap() {
+        Table* table = table_.load(memory_order_relaxed);
+        delete table->next.load(memory_order_relaxed);
+        delete table;
+    }
 
     ConcurrentHashMap(const ConcurrentHashMap&) = delete;
     ConcurrentHashMap& operator = (const ConcurrentHashMap&) = delete;
 
     optional<Value> get(const Key& key) const {
-        const auto& bucket = getBucket(key);
-        shared_lock lock(bucket.mutex);
+        return getImpl(key);
+    }
 
-        for (const auto& [k, v] : bucket.items) {
-            if (k == key) {
-                return v;
+    // Lookup by anything the transparent Hash/KeyEqual accept, e.g. a
+    // string_view or const char* for string keys.
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    optional<Value> get(const K& key) const {
+        return getImpl(key);
+    }
+
+    // Looks up a whole batch, taking each bucket's lock once. results[i]
+    // belongs to keys[i].
+    vector<optional<Value>> multi_get(const Key* keys, size_t count) const {
+        vector<optional<Value>> results(count);
+        multi_get(keys, count, [&](size_t index, const Value* value) {
+            if (value) {
+                results[index] = *value;
             }
-        }
-        return nullopt;
+        });
+        return results;
     }
 
-    void put(const Key& key, const Value& value){
-        auto& bucket = getBucket(key);
-        unique_lock lock(bucket.mutex);
+    vector<optional<Value>> multi_get(const vector<Key>& keys) const {
+        return multi_get(keys.data(), keys.size());
+    }
 
-        for(auto& [k, v] : bucket.items){
-            if (k == key){
-                v = value;
-                return;
+    // Callback form: fn(size_t index, const Value* value) runs once per key,
+    // with value null for missing keys. Calls are not in input order, and
+    // may run under a bucket's shared lock, so the same rules as visit()
+    // apply. value is only valid during the call.
+    template<typename F>
+    void multi_get(const Key* keys, size_t count, F&& fn) const {
+        multiGetImpl(keys, count, fn);
+    }
+
+    // Writes a batch of key/value pairs, taking each bucket's exclusive lock
+    // once for all of its entries. See BatchMode for the visibility choices.
+    void multi_put(const pair<Key, Value>* entries, size_t count, BatchMode mode = BatchMode::PerBucket) {
+        auto apply = [this](Bucket& bucket, const pair<Key, Value>& entry) {
+            size_t slot = bucket.items.find(entry.first, equal_);
+            if (slot != bucket.items.npos) {
+                bucket.items.value(slot) = entry.second;
+                return false;
             }
-        }
+            bucket.items.emplace(entry.first, entry.second);
+            return true;
+        };
+        batchWrite(entries, count, mode, apply);
+    }
 
-        bucket.item.emplace_back(key,value);
+    void multi_put(const vector<pair<Key, Value>>& entries, BatchMode mode = BatchMode::PerBucket) {
+        multi_put(entries.data(), entries.size(), mode);
     }
 
-    bool remove(const Key& key) {
-        auto& bucket = getBucket(key);
-        unique_lock lock(bucket.mutex);
+    // Batched merge(): for each (key, delta), stores delta if the key is
+    // absent, otherwise replaces the value with fn(current, delta). Deltas for
+    // the same key are applied in input order.
+    template<typename Delta, typename F = plus<>>
+    void apply_deltas(const pair<Key, Delta>* deltas, size_t count, F fn = F(),
+                      BatchMode mode = BatchMode::PerBucket) {
+        auto apply = [this, &fn](Bucket& bucket, const pair<Key, Delta>& entry) {
+            size_t slot = bucket.items.find(entry.first, equal_);
+            if (slot != bucket.items.npos) {
+                Value& current = bucket.items.value(slot);
+                current = fn(std::as_const(current), entry.second);
+                return false;
+            }
+            bucket.items.emplace(entry.first, entry.second);
+            return true;
+        };
+        batchWrite(deltas, count, mode, apply);
+    }
+
+    template<typename Delta, typename F = plus<>>
+    void apply_deltas(const vector<pair<Key, Delta>>& deltas, F fn = F(),
+                      BatchMode mode = BatchMode::PerBucket) {
+        apply_deltas(deltas.data(), deltas.size(), fn, mode);
+    }
+
+    // Inserts or overwrites. Both overloads take the value by forwarding
+    // reference, so temporaries are moved into the map rather than copied.
+    template<typename V = Value>
+    void put(const Key& key, V&& value) {
+        insertOrAssignImpl(key, std::forward<V>(value));
+    }
+
+    template<typename V = Value>
+    void put(Key&& key, V&& value) {
+        insertOrAssignImpl(std::move(key), std::forward<V>(value));
+    }
+
+    // Same as put(), but reports whether a new entry was created.
+    template<typename V>
+    bool insert_or_assign(const Key& key, V&& value) {
+        return insertOrAssignImpl(key, std::forward<V>(value));
+    }
+
+    template<typename V>
+    bool insert_or_assign(Key&& key, V&& value) {
+        return insertOrAssignImpl(std::move(key), std::forward<V>(value));
+    }
 
-        auto it = std::find_if(bucket.items.begin(), bucket.items.end(),
-            [&key](const auto& pair) { return pair.first == key; });
+    // Constructs the value in place from args only if the key is absent;
+    // otherwise leaves both the map and args untouched.
+    template<typename... Args>
+    bool try_emplace(const Key& key, Args&&... args) {
+        return tryEmplaceImpl(key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    bool try_emplace(Key&& key, Args&&... args) {
+        return tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // Builds a pair<Key, Value> from args outside the lock (the key has to
+    // exist before the bucket is known) and moves it in if the key is absent.
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        pair<Key, Value> entry(std::forward<Args>(args)...);
+        return tryEmplaceImpl(std::move(entry.first), std::move(entry.second));
+    }
 
-        if (it != bucket.items.end()) {
-            bucket.items.erase(it);
+    // Atomic read-modify-write operations. Each one hashes the key once,
+    // scans the bucket once and runs fn under a single exclusive lock, so the
+    // usual get-then-put race can't happen. fn must not call back into the map.
+
+    // fn(const Value* current) -> optional<Value>, where current is null if the
+    // key is absent. Returning a value stores it; returning nullopt removes
+    // the key. Returns the value now stored, if any.
+    template<typename F>
+    optional<Value> compute(const Key& key, F&& fn) {
+        countOp(StatOp::Compute);
+        helpResize();
+        int delta = 0;
+        optional<Value> result = writeBucket(hashKey(key), [&](Bucket& bucket) -> optional<Value> {
+            size_t slot = bucket.items.find(key, equal_);
+            bool present = slot != bucket.items.npos;
+            const Value* current = present ? &bucket.items.value(slot) : nullptr;
+            optional<Value> updated = fn(current);
+            if (!updated) {
+                if (present) {
+                    bucket.items.erase(slot);
+                    delta = -1;
+                }
+                return nullopt;
+            }
+            if (present) {
+                bucket.items.value(slot) = std::move(*updated);
+            } else {
+                slot = bucket.items.emplace(key, std::move(*updated));
+                delta = 1;
+            }
+            return bucket.items.value(slot);
+        });
+        applyCountDelta(delta);
+        return result;
+    }
+
+    // Runs fn(Value&) on the stored value in place if the key is present.
+    // Returns whether it was.
+    template<typename F>
+    bool compute_if_present(const Key& key, F&& fn) {
+        countOp(StatOp::Compute);
+        helpResize();
+        return writeBucket(hashKey(key), [&](Bucket& bucket) {
+            size_t slot = bucket.items.find(key, equal_);
+            if (slot == bucket.items.npos) {
+                return false;
+            }
+            fn(bucket.items.value(slot));
             return true;
+        });
+    }
+
+    // Inserts fn() if the key is absent; fn is not called otherwise. Returns
+    // whether a new entry was created.
+    template<typename F>
+    bool compute_if_absent(const Key& key, F&& fn) {
+        countOp(StatOp::Compute);
+        helpResize();
+        bool inserted = writeBucket(hashKey(key), [&](Bucket& bucket) {
+            if (bucket.items.find(key, equal_) != bucket.items.npos) {
+                return false;
+            }
+            bucket.items.emplace(key, fn());
+            return true;
+        });
+        if (inserted) {
+            onInserted();
         }
-        return false;
+        return inserted;
+    }
+
+    // Stores value if the key is absent, otherwise replaces the current value
+    // with fn(current, value) - e.g. merge(account, qty, plus<>()) to book a
+    // fill. Returns the value now stored.
+    template<typename V, typename F>
+    Value merge(const Key& key, V&& value, F&& fn) {
+        countOp(StatOp::Compute);
+        helpResize();
+        bool inserted = false;
+        Value result = writeBucket(hashKey(key), [&](Bucket& bucket) -> Value {
+            size_t slot = bucket.items.find(key, equal_);
+            if (slot == bucket.items.npos) {
+                slot = bucket.items.emplace(key, std::forward<V>(value));
+                inserted = true;
+            } else {
+                Value& current = bucket.items.value(slot);
+                current = fn(std::as_const(current), std::forward<V>(value));
+            }
+            return bucket.items.value(slot);
+        });
+        if (inserted) {
+            onInserted();
+        }
+        return result;
+    }
+
+    bool remove(const Key& key) {
+        return removeImpl(key);
+    }
+
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    bool remove(const K& key) {
+        return removeImpl(key);
     }
 
     bool contains(const Key& key) const {
-        return get(key).has_value();
+        return containsImpl(key);
     }
 
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    bool contains(const K& key) const {
+        return containsImpl(key);
+    }
+
+    // Zero-copy read: runs fn(const Value&) on the stored value while the
+    // bucket's shared lock is held and returns whether the key was found.
+    // Keep fn short - writers to this bucket wait until it returns - and
+    // don't call back into the map from it.
+    template<typename F>
+    bool visit(const Key& key, F&& fn) const {
+        return visitImpl(key, fn);
+    }
+
+    template<typename K, typename F, typename = enable_if_t<IsLookupKey<K>>>
+    bool visit(const K& key, F&& fn) const {
+        return visitImpl(key, fn);
+    }
+
+    // Exact number of entries at some instant during the call, counting only
+    // operations that have returned. Reads the striped counter until two
+    // passes agree; only under constant writes does it fall back to locking
+    // each bucket in turn.
     size_t size() const {
         size_t total = 0;
-        for (const auto& bucket : buckets_) {
-            std::shared_lock lock(bucket.mutex);
-            total += bucket.items.size();
+        for (int attempt = 0; attempt < MaxSizeSnapshotAttempts; ++attempt) {
+            if (count_.trySnapshot(total)) {
+                return total;
+            }
         }
+        total = 0;
+        forEachBucket<ReadLock>([&](const Bucket& bucket) {
+            total += bucket.items.size();
+        });
         return total;
     }
 
+    // Lock-free, O(1) in the map size, and may be off by the writes in flight.
+    // Cheap enough to poll from a monitoring thread.
+    size_t approximate_size() const {
+        return count_.approximate();
+    }
+
+    // Calls fn(const Key&, Value&) for every entry, one bucket at a time under
+    // that bucket's write lock. Entries in buckets already visited can change
+    // behind the traversal. fn must not call back into the map.
+    template<typename F>
+    void for_each(F&& fn) {
+        forEachBucket<WriteLock>([&](Bucket& bucket) {
+            bucket.items.forEach(fn);
+        });
+    }
+
+    // Read-only for_each: fn(const Key&, const Value&) under each bucket's
+    // read lock, so it runs alongside other readers.
+    template<typename F>
+    void for_each_const(F&& fn) const {
+        forEachBucket<ReadLock>([&](const Bucket& bucket) {
+            bucket.items.forEach(fn);
+        });
+    }
+
+    // Traversal split by range: the map is divided into range_count() slots,
+    // fixed for the map's lifetime no matter how often the table has grown,
+    // and these visit only slots [first, last). Consumers that agree on how
+    // to cut [0, range_count()) cover every entry exactly once between them.
+    static constexpr size_t range_count() {
+        return NumBuckets;
+    }
+
+    template<typename F>
+    void for_each_range(size_t first, size_t last, F&& fn) {
+        forEachBucketInRange<WriteLock>(first, last, [&](Bucket& bucket) {
+            bucket.items.forEach(fn);
+        });
+    }
+
+    template<typename F>
+    void for_each_const_range(size_t first, size_t last, F&& fn) const {
+        forEachBucketInRange<ReadLock>(first, last, [&](const Bucket& bucket) {
+            bucket.items.forEach(fn);
+        });
+    }
+
+    // for_each_const spread over a pool: the slots are cut into chunks and
+    // each chunk is walked under its buckets' read locks on whichever pool
+    // thread gets to it (the caller included). fn must be safe to call from
+    // several threads at once.
+    template<typename F>
+    void parallel_for_each(F&& fn, ThreadPool& pool = ThreadPool::shared()) const {
+        size_t chunk = parallelChunkSize(pool);
+        pool.parallel_for((NumBuckets + chunk - 1) / chunk, [&](size_t c) {
+            for_each_const_range(c * chunk, (c + 1) * chunk, fn);
+        });
+    }
+
+    // Transform-reduce over every entry: folds reduce(acc, transform(key,
+    // value)) per chunk starting from identity, then folds the chunk results
+    // in order. reduce should be associative and identity its neutral element.
+    template<typename T, typename Transform, typename Reduce>
+    T parallel_reduce(T identity, Transform transform, Reduce reduce,
+                      ThreadPool& pool = ThreadPool::shared()) const {
+        size_t chunk = parallelChunkSize(pool);
+        size_t chunks = (NumBuckets + chunk - 1) / chunk;
+        vector<T> partials(chunks, identity);
+        pool.parallel_for(chunks, [&](size_t c) {
+            T acc = identity;
+            for_each_const_range(c * chunk, (c + 1) * chunk, [&](const Key& k, const Value& v) {
+                acc = reduce(std::move(acc), transform(k, v));
+            });
+            partials[c] = std::move(acc);
+        });
+
+        T result = std::move(identity);
+        for (auto& partial : partials) {
+            result = reduce(std::move(result), std::move(partial));
+        }
+        return result;
+    }
+
+    // Counters and bucket shape for tuning NumBuckets; only available with
+    // Traits::CollectStats. The counters are summed without stopping writers,
+    // and the chain lengths come from a pass over every bucket under its read
+    // lock, so treat it as a monitoring snapshot rather than an exact state.
+    template<bool Enabled = Traits::CollectStats>
+    MapStats stats() const {
+        static_assert(Enabled, "stats() needs a Traits with CollectStats = true");
+        MapStats result;
+        stats_.collect(result);
+        forEachBucket<ReadLock>([&](const Bucket& bucket) {
+            size_t length = bucket.items.size();
+            if (length >= result.chain_length_histogram.size()) {
+                result.chain_length_histogram.resize(length + 1, 0);
+            }
+            ++result.chain_length_histogram[length];
+            result.max_chain_length = max(result.max_chain_length, length);
+            ++result.bucket_count;
+        });
+        return result;
+    }
+
+    // Keys currently served from per-core replicas; only available with
+    // Traits::HotKeyReplicas. Promotion and demotion happen on lookups, so
+    // this is a snapshot for monitoring.
+    template<bool Enabled = Traits::HotKeyReplicas>
+    vector<Key> hot_keys() const {
+        static_assert(Enabled, "hot_keys() needs a Traits with HotKeyReplicas = true");
+        return hotKeys_.keys();
+    }
+
+    // Number of buckets in the newest table, including one still being
+    // filled by an in-progress resize.
+    size_t bucket_count() const {
+        Table* table = table_.load(memory_order_acquire);
+        Table* next = table->next.load(memory_order_acquire);
+        return next ? next->size : table->size;
+    }
+
     void clear() {
-        for (auto& bucket : buckets_) {
-            std::unique_lock lock(bucket.mutex);
+        forEachBucket<WriteLock>([&](Bucket& bucket) {
+            count_.subtract(bucket.items.size());
             bucket.items.clear();
-        }
+        });
     }
 };
 
-#endif // CONCURRENT_HASHMAP_HPP
\ No newline at end of file
+#endif // CONCURRENT_HASHMAP_HPP
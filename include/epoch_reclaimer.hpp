@@ -0,0 +1,179 @@
+#ifndef EPOCH_RECLAIMER_HPP
+#define EPOCH_RECLAIMER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Epoch-based memory reclamation.
+//
+// Lock-free readers pin the current global epoch for as long as they hold raw
+// pointers into a shared structure. Writers unlink a node first and then
+// retire() it; the node is only freed once the global epoch has moved two
+// steps past the epoch it was retired in, which can only happen after every
+// reader that might still see it has unpinned.
+//
+// There is one process-wide domain. Each thread gets a record the first time it
+// pins or retires; records are recycled when threads exit, together with any
+// garbage the old owner had not freed yet.
+class EpochReclaimer {
+    static constexpr uint64_t Idle = UINT64_MAX;
+    static constexpr size_t CollectThreshold = 64;
+
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    struct alignas(64) ThreadRecord {
+        atomic<uint64_t> epoch{Idle};
+        atomic<bool> inUse{true};
+        ThreadRecord* next = nullptr;  // registry link, fixed once published
+
+        // Only touched by the owning thread.
+        unsigned nesting = 0;
+        size_t retiredSinceCollect = 0;
+        vector<Retired> limbo;
+    };
+
+public:
+    // Pins the calling thread to the current epoch for the guard's lifetime.
+    // Guards nest freely.
+    class Guard {
+    public:
+        Guard() : record_(EpochReclaimer::instance().localRecord()) {
+            if (record_->nesting++ == 0) {
+                uint64_t epoch = EpochReclaimer::instance().globalEpoch_.load(memory_order_relaxed);
+                record_->epoch.store(epoch, memory_order_relaxed);
+                // The pin must be visible before we load any shared pointer.
+                atomic_thread_fence(memory_order_seq_cst);
+            }
+        }
+
+        ~Guard() {
+            if (--record_->nesting == 0) {
+                record_->epoch.store(Idle, memory_order_release);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        ThreadRecord* record_;
+    };
+
+    // Deliberately never destroyed: exiting threads still release their
+    // records through it during static destruction.
+    static EpochReclaimer& instance() {
+        static EpochReclaimer* reclaimer = new EpochReclaimer;
+        return *reclaimer;
+    }
+
+    // Hands an already-unlinked object over for deferred deletion.
+    template<typename T>
+    void retire(T* ptr) {
+        retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    void retire(void* ptr, void (*deleter)(void*)) {
+        ThreadRecord* record = localRecord();
+        atomic_thread_fence(memory_order_seq_cst);
+        record->limbo.push_back({ptr, deleter, globalEpoch_.load(memory_order_relaxed)});
+        if (++record->retiredSinceCollect >= CollectThreshold) {
+            record->retiredSinceCollect = 0;
+            tryAdvance();
+            collect(record);
+        }
+    }
+
+    // Frees whatever of the calling thread's garbage no reader can still
+    // see, without waiting for CollectThreshold retires. For writers that
+    // retire rarely but large, where waiting for 64 retires could keep a lot
+    // of memory alive for a long time. It takes two advances to get past the
+    // epoch of the last retire; either one fails harmlessly while a reader
+    // is still pinned to an older epoch.
+    void flush() {
+        ThreadRecord* record = localRecord();
+        record->retiredSinceCollect = 0;
+        tryAdvance();
+        tryAdvance();
+        collect(record);
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+private:
+    // Releases the thread's record when the thread exits.
+    struct LocalHandle {
+        ThreadRecord* record = nullptr;
+
+        ~LocalHandle() {
+            if (record) {
+                EpochReclaimer::instance().tryAdvance();
+                EpochReclaimer::instance().collect(record);
+                record->inUse.store(false, memory_order_release);
+            }
+        }
+    };
+
+    EpochReclaimer() = default;
+
+    ThreadRecord* localRecord() {
+        thread_local LocalHandle handle;
+        if (!handle.record) {
+            handle.record = acquireRecord();
+        }
+        return handle.record;
+    }
+
+    ThreadRecord* acquireRecord() {
+        for (ThreadRecord* r = registry_.load(memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->inUse.load(memory_order_relaxed) &&
+                r->inUse.compare_exchange_strong(expected, true, memory_order_acquire)) {
+                return r;
+            }
+        }
+        auto* record = new ThreadRecord;
+        record->next = registry_.load(memory_order_relaxed);
+        while (!registry_.compare_exchange_weak(record->next, record,
+                                                memory_order_release, memory_order_relaxed)) {
+        }
+        return record;
+    }
+
+    // Bumps the global epoch if every pinned thread has caught up with it.
+    void tryAdvance() {
+        uint64_t epoch = globalEpoch_.load(memory_order_acquire);
+        for (ThreadRecord* r = registry_.load(memory_order_acquire); r; r = r->next) {
+            uint64_t pinned = r->epoch.load(memory_order_acquire);
+            if (pinned != Idle && pinned != epoch) {
+                return;
+            }
+        }
+        globalEpoch_.compare_exchange_strong(epoch, epoch + 1, memory_order_acq_rel);
+    }
+
+    void collect(ThreadRecord* record) {
+        uint64_t epoch = globalEpoch_.load(memory_order_acquire);
+        auto& limbo = record->limbo;
+        size_t kept = 0;
+        for (size_t i = 0; i < limbo.size(); ++i) {
+            if (limbo[i].epoch + 2 <= epoch) {
+                limbo[i].deleter(limbo[i].ptr);
+            } else {
+                limbo[kept++] = limbo[i];
+            }
+        }
+        limbo.resize(kept);
+    }
+
+    atomic<uint64_t> globalEpoch_{0};
+    atomic<ThreadRecord*> registry_{nullptr};
+};
+
+#endif // EPOCH_RECLAIMER_HPP
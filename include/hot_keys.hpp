@@ -0,0 +1,253 @@
+#ifndef HOT_KEYS_HPP
+#define HOT_KEYS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "epoch_reclaimer.hpp"
+#include "map_traits.hpp"
+#include "striped_counter.hpp"
+using namespace std;
+
+// Hot-key detection and per-core read replicas behind
+// Traits::HotKeyReplicas.
+//
+// A sampled fraction of lookups bump a small table of decaying counters
+// indexed by hash. A key whose counter crosses PromoteSamples gets an Entry
+// holding one Replica per stripe (the same thread-to-stripe mapping as the
+// size counter), each on its own cache line. A reader of a hot key only
+// touches its own stripe's replica, so lookups of one key from many cores
+// no longer all write the same bucket lock word.
+//
+// A replica points to an immutable snapshot: a copy of the value plus the
+// version of the bucket it was copied from. Every write to the bucket bumps
+// that version, which is what invalidates the copies: a reader that finds
+// the version moved copies the value again under the bucket's read lock and
+// swaps in a new snapshot, retiring the old one to EpochReclaimer. Keys
+// whose replicas see fewer than DemoteHits reads between two decays are
+// demoted again.
+template<typename Key, typename Value>
+class HotKeyCache {
+public:
+    static constexpr size_t MaxHotKeys = 8;
+
+    struct Snapshot {
+        const atomic<uint32_t>* version;  // of the bucket it was copied from
+        uint32_t filledAt;
+        optional<Value> value;  // nullopt caches a miss
+    };
+
+    struct alignas(CacheLineSize) Replica {
+        atomic<Snapshot*> snapshot{nullptr};
+        atomic<uint64_t> hits{0};
+    };
+
+    // Key and hash never change once published, so readers can compare them
+    // without a lock; entries are freed through EpochReclaimer.
+    struct Entry {
+        Entry(const Key& k, size_t h) : key(k), hash(h) {}
+
+        ~Entry() {
+            for (auto& replica : replicas) {
+                delete replica.snapshot.load(memory_order_relaxed);
+            }
+        }
+
+        const Key key;
+        const size_t hash;
+        array<Replica, StripedCounter::Stripes> replicas;
+    };
+
+    HotKeyCache() {
+        for (size_t i = 0; i < sampling_.size(); ++i) {
+            sampling_[i].rng.store(0x9E3779B9u ^ static_cast<uint32_t>(i), memory_order_relaxed);
+        }
+    }
+
+    ~HotKeyCache() {
+        for (auto& slot : slots_) {
+            delete slot.load(memory_order_relaxed);
+        }
+    }
+
+    HotKeyCache(const HotKeyCache&) = delete;
+    HotKeyCache& operator=(const HotKeyCache&) = delete;
+
+    bool empty() const {
+        return active_.load(memory_order_relaxed) == 0;
+    }
+
+    // Caller must hold an EpochReclaimer::Guard for as long as it uses the
+    // returned entry.
+    template<typename K, typename KeyEqual>
+    Entry* find(const K& key, size_t hash, const KeyEqual& equal) const {
+        for (size_t i = 0; i < MaxHotKeys; ++i) {
+            if (hashes_[i].load(memory_order_relaxed) != hash) {
+                continue;
+            }
+            Entry* entry = slots_[i].load(memory_order_acquire);
+            if (entry && entry->hash == hash && equal(entry->key, key)) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // Copies the calling thread's replica into `value` if it is still
+    // current. Returns false if it has to be refilled. Caller must hold an
+    // EpochReclaimer::Guard.
+    static bool read(Entry& entry, optional<Value>& value) {
+        Replica& replica = entry.replicas[StripedCounter::stripeIndex()];
+        // Threads sharing a stripe can lose each other's increments; it is
+        // only a demotion heuristic, and not worth a locked add per read.
+        replica.hits.store(replica.hits.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        const Snapshot* snapshot = replica.snapshot.load(memory_order_acquire);
+        if (snapshot && snapshot->version->load(memory_order_acquire) == snapshot->filledAt) {
+            value = snapshot->value;
+            return true;
+        }
+        return false;
+    }
+
+    // Caller must hold an EpochReclaimer::Guard and the read lock of the
+    // bucket `version` belongs to, so no write can slip in between reading
+    // the value and recording the version it was read at.
+    static void fill(Entry& entry, const atomic<uint32_t>& version, const optional<Value>& value) {
+        Replica& replica = entry.replicas[StripedCounter::stripeIndex()];
+        auto* snapshot = new Snapshot{&version, version.load(memory_order_relaxed), value};
+        if (Snapshot* old = replica.snapshot.exchange(snapshot, memory_order_acq_rel)) {
+            EpochReclaimer::instance().retire(old);
+        }
+    }
+
+    // True for roughly one call in SampleInterval. A per-stripe xorshift
+    // rather than a countdown, so a loop over a multiple of SampleInterval
+    // keys doesn't sample the same key every time round.
+    bool sample() {
+        atomic<uint32_t>& rng = sampling_[StripedCounter::stripeIndex()].rng;
+        // Threads sharing a stripe can step on each other's state; any
+        // xorshift output is as good a next state as another, and none is 0.
+        uint32_t state = rng.load(memory_order_relaxed);
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        rng.store(state, memory_order_relaxed);
+        return (state & (SampleInterval - 1)) == 0;
+    }
+
+    // Counts a sampled lookup; promotes the key once its counter crosses
+    // PromoteSamples, and runs a decay every DecaySamples samples per stripe.
+    template<typename K, typename KeyEqual>
+    void record(const K& key, size_t hash, const KeyEqual& equal) {
+        atomic<uint32_t>& counter = candidates_[candidateIndex(hash)];
+        if (counter.fetch_add(1, memory_order_relaxed) + 1 >= PromoteSamples) {
+            promote(key, hash, equal, counter);
+        }
+        atomic<uint32_t>& samples = sampling_[StripedCounter::stripeIndex()].samples;
+        uint32_t sampled = samples.load(memory_order_relaxed) + 1;
+        samples.store(sampled, memory_order_relaxed);
+        if (sampled % DecaySamples == 0) {
+            decay();
+        }
+    }
+
+    vector<Key> keys() const {
+        EpochReclaimer::Guard guard;
+        vector<Key> result;
+        for (const auto& slot : slots_) {
+            if (const Entry* entry = slot.load(memory_order_acquire)) {
+                result.push_back(entry->key);
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint32_t SampleInterval = 64;  // power of two
+    static constexpr size_t CandidateSlots = 1024;  // power of two
+    static constexpr uint32_t PromoteSamples = 16;
+    static constexpr uint32_t DecaySamples = 256;
+    static constexpr uint64_t DemoteHits = 256;
+
+    // Sampling state, kept per map so one map's traffic doesn't drive
+    // another's detection, and per stripe so threads on different stripes
+    // don't share a line.
+    struct alignas(CacheLineSize) SamplingStripe {
+        atomic<uint32_t> rng{0};
+        atomic<uint32_t> samples{0};
+    };
+
+    static size_t candidateIndex(size_t hash) {
+        uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(mixed >> 32) & (CandidateSlots - 1);
+    }
+
+    // Promotion and decay are best effort: if another thread is already at
+    // it, skip rather than wait on a lookup path.
+    template<typename K, typename KeyEqual>
+    void promote(const K& key, size_t hash, const KeyEqual& equal, atomic<uint32_t>& counter) {
+        unique_lock lock(mutex_, try_to_lock);
+        if (!lock) {
+            return;
+        }
+        counter.store(0, memory_order_relaxed);
+        if (find(key, hash, equal)) {
+            return;
+        }
+        for (size_t i = 0; i < MaxHotKeys; ++i) {
+            if (!slots_[i].load(memory_order_relaxed)) {
+                slots_[i].store(new Entry(Key(key), hash), memory_order_release);
+                hashes_[i].store(hash, memory_order_relaxed);
+                active_.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // Halves every candidate counter and demotes entries that went cold
+    // since the last decay.
+    void decay() {
+        unique_lock lock(mutex_, try_to_lock);
+        if (!lock) {
+            return;
+        }
+        for (auto& counter : candidates_) {
+            counter.store(counter.load(memory_order_relaxed) / 2, memory_order_relaxed);
+        }
+        for (size_t i = 0; i < MaxHotKeys; ++i) {
+            Entry* entry = slots_[i].load(memory_order_relaxed);
+            if (!entry) {
+                continue;
+            }
+            uint64_t hits = 0;
+            for (auto& replica : entry->replicas) {
+                hits += replica.hits.exchange(0, memory_order_relaxed);
+            }
+            if (hits < DemoteHits) {
+                hashes_[i].store(0, memory_order_relaxed);
+                slots_[i].store(nullptr, memory_order_release);
+                active_.fetch_sub(1, memory_order_relaxed);
+                EpochReclaimer::instance().retire(entry);
+            }
+        }
+    }
+
+    // Read on every lookup while anything is hot, written only on promotion
+    // and demotion: one line of hashes to scan before touching any entry.
+    alignas(CacheLineSize) array<atomic<size_t>, MaxHotKeys> hashes_{};
+    array<atomic<Entry*>, MaxHotKeys> slots_{};
+    atomic<size_t> active_{0};
+    alignas(CacheLineSize) array<atomic<uint32_t>, CandidateSlots> candidates_{};
+    array<SamplingStripe, StripedCounter::Stripes> sampling_;
+    mutex mutex_;
+};
+
+// Stand-in when hot-key replicas are off: no members, and the map never
+// calls into it.
+class NoHotKeys {};
+
+#endif // HOT_KEYS_HPP
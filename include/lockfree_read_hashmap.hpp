@@ -0,0 +1,188 @@
+#ifndef LOCKFREE_READ_HASHMAP_HPP
+#define LOCKFREE_READ_HASHMAP_HPP
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include "epoch_reclaimer.hpp"
+using namespace std;
+
+// Same API as ConcurrentHashMap, tuned for read-mostly workloads.
+//
+// get() and contains() walk the bucket chain without taking any lock: they
+// only pin the current epoch. Writers still serialize on a per-bucket mutex.
+// Nodes are never modified once published - put() on an existing key links in
+// a fresh node and retires the old one - so a reader always sees a complete
+// key/value pair, and retired nodes are freed by EpochReclaimer only after
+// every reader that could still reach them has left.
+//
+// The bucket count is fixed at NumBuckets. Nodes come from Allocator, which is
+// default-constructed wherever it is needed (including when EpochReclaimer
+// frees a retired node), so it must be stateless. With every update
+// allocating a node, PoolAllocator (pool_allocator.hpp) keeps steady-state
+// churn off the system allocator.
+template<typename Key, typename Value, size_t NumBuckets = 1024,
+         typename Allocator = allocator<pair<const Key, Value>>>
+class LockFreeReadHashMap {
+private:
+    static_assert(NumBuckets > 0, "NumBuckets must be at least 1");
+
+    struct Node {
+        Node(const Key& k, const Value& v, Node* n) : key(k), value(v), next(n) {}
+
+        const Key key;
+        const Value value;
+        atomic<Node*> next;
+    };
+
+    using NodeAllocator = typename allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = allocator_traits<NodeAllocator>;
+
+    struct Bucket {
+        mutex writeMutex;
+        atomic<Node*> head{nullptr};
+    };
+
+    array<Bucket,NumBuckets> buckets_;
+    atomic<size_t> count_{0};
+
+    size_t getBucketIndex(const Key& key) const {
+        return hash<Key>{}(key) % NumBuckets;
+    }
+
+    Bucket& getBucket(const Key& key) {
+        return buckets_[getBucketIndex(key)];
+    }
+
+    const Bucket& getBucket(const Key& key) const {
+        return buckets_[getBucketIndex(key)];
+    }
+
+    static Node* makeNode(const Key& key, const Value& value, Node* next) {
+        NodeAllocator alloc;
+        Node* node = NodeTraits::allocate(alloc, 1);
+        try {
+            NodeTraits::construct(alloc, node, key, value, next);
+        } catch (...) {
+            NodeTraits::deallocate(alloc, node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    static void destroyNode(void* ptr) {
+        NodeAllocator alloc;
+        Node* node = static_cast<Node*>(ptr);
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+    }
+
+    static void retireNode(Node* node) {
+        EpochReclaimer::instance().retire(node, &destroyNode);
+    }
+
+    // Caller must hold an EpochReclaimer::Guard.
+    const Node* find(const Key& key) const {
+        const Bucket& bucket = getBucket(key);
+        for (Node* node = bucket.head.load(memory_order_acquire); node;
+             node = node->next.load(memory_order_acquire)) {
+            if (node->key == key) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    LockFreeReadHashMap() = default;
+
+    ~LockFreeReadHashMap() {
+        for (auto& bucket : buckets_) {
+            Node* node = bucket.head.load(memory_order_relaxed);
+            while (node) {
+                Node* next = node->next.load(memory_order_relaxed);
+                destroyNode(node);
+                node = next;
+            }
+        }
+    }
+
+    LockFreeReadHashMap(const LockFreeReadHashMap&) = delete;
+    LockFreeReadHashMap& operator = (const LockFreeReadHashMap&) = delete;
+
+    optional<Value> get(const Key& key) const {
+        EpochReclaimer::Guard guard;
+        if (const Node* node = find(key)) {
+            return node->value;
+        }
+        return nullopt;
+    }
+
+    bool contains(const Key& key) const {
+        EpochReclaimer::Guard guard;
+        return find(key) != nullptr;
+    }
+
+    void put(const Key& key, const Value& value) {
+        auto& bucket = getBucket(key);
+        lock_guard lock(bucket.writeMutex);
+
+        atomic<Node*>* link = &bucket.head;
+        for (Node* node = link->load(memory_order_relaxed); node;
+             node = link->load(memory_order_relaxed)) {
+            if (node->key == key) {
+                Node* replacement = makeNode(key, value, node->next.load(memory_order_relaxed));
+                link->store(replacement, memory_order_release);
+                retireNode(node);
+                return;
+            }
+            link = &node->next;
+        }
+
+        Node* head = bucket.head.load(memory_order_relaxed);
+        bucket.head.store(makeNode(key, value, head), memory_order_release);
+        count_.fetch_add(1, memory_order_relaxed);
+    }
+
+    bool remove(const Key& key) {
+        auto& bucket = getBucket(key);
+        lock_guard lock(bucket.writeMutex);
+
+        atomic<Node*>* link = &bucket.head;
+        for (Node* node = link->load(memory_order_relaxed); node;
+             node = link->load(memory_order_relaxed)) {
+            if (node->key == key) {
+                // Readers standing on `node` can still follow its next pointer,
+                // which stays intact until the node is freed.
+                link->store(node->next.load(memory_order_relaxed), memory_order_release);
+                retireNode(node);
+                count_.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+            link = &node->next;
+        }
+        return false;
+    }
+
+    size_t size() const {
+        return count_.load(memory_order_relaxed);
+    }
+
+    void clear() {
+        for (auto& bucket : buckets_) {
+            lock_guard lock(bucket.writeMutex);
+            Node* node = bucket.head.exchange(nullptr, memory_order_acq_rel);
+            while (node) {
+                Node* next = node->next.load(memory_order_relaxed);
+                retireNode(node);
+                count_.fetch_sub(1, memory_order_relaxed);
+                node = next;
+            }
+        }
+    }
+};
+
+#endif // LOCKFREE_READ_HASHMAP_HPP
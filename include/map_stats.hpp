@@ -0,0 +1,117 @@
+#ifndef MAP_STATS_HPP
+#define MAP_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "map_traits.hpp"
+#include "striped_counter.hpp"
+using namespace std;
+
+// Operation kinds counted by a map built with Traits::CollectStats.
+enum class StatOp {
+    Get,          // get()
+    Contains,     // contains()
+    Visit,        // visit()
+    Insert,       // put(), emplace(), try_emplace(), insert_or_assign()
+    Remove,       // remove()
+    Compute,      // compute*(), merge()
+    MultiGet,     // multi_get(), once per batch
+    MultiWrite,   // multi_put(), apply_deltas(), once per batch
+    Count
+};
+
+// Snapshot returned by ConcurrentHashMap::stats().
+struct MapStats {
+    // Bucket 0 is waits under 1 ns, bucket i is [2^(i-1), 2^i) ns, and the
+    // last bucket takes everything longer.
+    static constexpr size_t WaitBuckets = 32;
+
+    // Blocking bucket lock acquisitions, and how many of them found the lock
+    // already held. Seqlock reads never lock and aren't counted.
+    uint64_t lock_acquisitions = 0;
+    uint64_t contended_acquisitions = 0;
+    array<uint64_t, WaitBuckets> lock_wait_histogram{};
+
+    // chain_length_histogram[n] is the number of buckets holding n entries.
+    vector<size_t> chain_length_histogram;
+    size_t max_chain_length = 0;
+    size_t bucket_count = 0;
+
+    array<uint64_t, static_cast<size_t>(StatOp::Count)> operations{};
+
+    uint64_t operation_count(StatOp op) const {
+        return operations[static_cast<size_t>(op)];
+    }
+};
+
+// Per-map counters behind stats(). Threads write to their own stripe (the
+// same one they use for the map's size counter), so the instrumentation
+// doesn't add a shared cache line of its own; stats() sums the stripes.
+class StatsCollector {
+public:
+    void recordOp(StatOp op) {
+        bump(localStripe().operations[static_cast<size_t>(op)]);
+    }
+
+    void recordLock() {
+        bump(localStripe().acquisitions);
+    }
+
+    void recordContendedLock(uint64_t waitNanos) {
+        Stripe& stripe = localStripe();
+        bump(stripe.acquisitions);
+        bump(stripe.contended);
+        bump(stripe.waits[waitBucket(waitNanos)]);
+    }
+
+    // Fills in the lock and operation counters; the shape fields are left to
+    // the map.
+    void collect(MapStats& stats) const {
+        for (const auto& stripe : stripes_) {
+            stats.lock_acquisitions += stripe.acquisitions.load(memory_order_relaxed);
+            stats.contended_acquisitions += stripe.contended.load(memory_order_relaxed);
+            for (size_t i = 0; i < MapStats::WaitBuckets; ++i) {
+                stats.lock_wait_histogram[i] += stripe.waits[i].load(memory_order_relaxed);
+            }
+            for (size_t i = 0; i < stats.operations.size(); ++i) {
+                stats.operations[i] += stripe.operations[i].load(memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(CacheLineSize) Stripe {
+        atomic<uint64_t> acquisitions{0};
+        atomic<uint64_t> contended{0};
+        array<atomic<uint64_t>, MapStats::WaitBuckets> waits{};
+        array<atomic<uint64_t>, static_cast<size_t>(StatOp::Count)> operations{};
+    };
+
+    // With more threads than stripes a stripe is shared, hence the atomic add.
+    static void bump(atomic<uint64_t>& counter) {
+        counter.fetch_add(1, memory_order_relaxed);
+    }
+
+    static size_t waitBucket(uint64_t nanos) {
+        size_t bucket = 0;
+        while (nanos > 0 && bucket < MapStats::WaitBuckets - 1) {
+            nanos >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    Stripe& localStripe() {
+        return stripes_[StripedCounter::stripeIndex()];
+    }
+
+    array<Stripe, StripedCounter::Stripes> stripes_;
+};
+
+// Stand-in when stats are off: no members, and the map never calls into it.
+class NoStats {};
+
+#endif // MAP_STATS_HPP
@@ -0,0 +1,61 @@
+#ifndef MAP_TRAITS_HPP
+#define MAP_TRAITS_HPP
+
+#include <cstddef>
+#include <shared_mutex>
+using namespace std;
+
+inline constexpr size_t CacheLineSize = 64;
+
+// Compile-time knobs for ConcurrentHashMap. Derive from DefaultMapTraits and
+// override only what you need:
+//
+//     struct PackedTraits : DefaultMapTraits {
+//         static constexpr bool AlignBuckets = false;
+//     };
+//     ConcurrentHashMap<int, double, 1024, hash<int>, equal_to<int>, PackedTraits> positions;
+struct DefaultMapTraits {
+    // Start every bucket on its own cache line so threads holding neighbouring
+    // bucket locks don't invalidate each other's lines. Costs some padding per
+    // bucket; turn it off for very large, cold maps.
+    static constexpr bool AlignBuckets = true;
+
+    // Pick buckets by mixing the hash with a Fibonacci multiply and masking,
+    // instead of `hash % bucket_count`. Avoids an integer division per
+    // operation and spreads out identity-hashed keys that share a stride.
+    // Only applies to a power-of-two NumBuckets; other counts always use the
+    // modulo.
+    static constexpr bool FibonacciIndexing = true;
+
+    // Two-level table: keep the top level fixed at NumBuckets and let every
+    // bucket that outgrows its inline slots spill into its own small hash
+    // table, which doubles under that bucket's lock. There is never a
+    // map-wide resize, and only hot buckets pay for the extra memory.
+    static constexpr bool SegmentedBuckets = false;
+
+    // Count lock acquisitions, contention, lock wait times and operations,
+    // readable through stats(). Off, none of it is compiled in.
+    static constexpr bool CollectStats = false;
+
+    // Flat-combining writes: put(), insert_or_assign(), merge(), compute(),
+    // compute_if_present() and compute_if_absent() post their update to the
+    // bucket and the thread that gets the lock applies every posted update
+    // in one pass, so N writers to a hot key cost one lock handoff instead
+    // of N. The update - including a merge or compute fn - may run on
+    // another writer's thread. Only pays off when writers pile up on a few
+    // buckets.
+    static constexpr bool FlatCombining = false;
+
+    // Sample lookups to find the few keys that take most of the reads, and
+    // serve those from per-core copies that writers invalidate, so readers
+    // of a hot key stop fighting over its bucket's lock word. Keys drop out
+    // again once they cool down. See hot_keys.hpp.
+    static constexpr bool HotKeyReplicas = false;
+
+    // Lock type guarding each bucket. Anything with the SharedMutex interface
+    // works; bucket_locks.hpp has compact alternatives (SpinRWLock,
+    // TicketLock, FutexRWLock) to the 56-byte shared_mutex.
+    using BucketLock = shared_mutex;
+};
+
+#endif // MAP_TRAITS_HPP
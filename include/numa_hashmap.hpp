@@ -0,0 +1,198 @@
+#ifndef NUMA_HASHMAP_HPP
+#define NUMA_HASHMAP_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <vector>
+#include "concurrent_hashmap.hpp"
+#include "numa_topology.hpp"
+#include "pool_allocator.hpp"
+using namespace std;
+
+enum class NumaMode {
+    // Keys are split across one shard per node; each key lives on one node.
+    Partitioned,
+    // Every node holds a full copy. Reads stay on the caller's node, writes
+    // go to every copy - for read-mostly maps.
+    Replicated
+};
+
+// ConcurrentHashMap split into one shard per NUMA node, with every shard's
+// bucket array, bucket locks and overflow blocks in its own node's memory.
+//
+// On a two-socket box a plain map's bucket array lands on whichever node
+// touched it first, so half the threads go remote on every lookup. Here each
+// shard object is allocated on its node, and all of its allocations run
+// under a NumaPlacement scope for that node, so NumaAllocator keeps them
+// there no matter which thread triggers them (a resize, say).
+//
+// Partitioned mode doesn't make remote accesses go away; it makes them
+// predictable. home_node(key) says where a key lives, so a system that can
+// route work by key (one order-book thread per node, say) keeps everything
+// local. Replicated mode makes every read local at the cost of writing
+// through to every node; copies are updated one after another, so for a
+// moment a write can be visible on one node and not yet on another.
+//
+// On a single-node machine there is one shard and this is a plain
+// ConcurrentHashMap with a pooled allocator.
+template<typename Key, typename Value, size_t NumBuckets = 1024,
+         typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key>,
+         typename Traits = DefaultMapTraits>
+class NumaShardedHashMap {
+private:
+    using Shard = ConcurrentHashMap<Key, Value, NumBuckets, Hash, KeyEqual, Traits,
+                                    NumaAllocator<pair<const Key, Value>>>;
+
+    static constexpr size_t ReplicaWriteStripes = 64;
+    static constexpr size_t PageSize = 4096;
+
+    static constexpr size_t shardBytes() {
+        return (sizeof(Shard) + PageSize - 1) & ~(PageSize - 1);
+    }
+
+    struct ShardDeleter {
+        size_t node;
+
+        void operator()(Shard* shard) const {
+            NumaPlacement::Scope scope(node);
+            shard->~Shard();
+            NumaTopology::release(shard, shardBytes());
+        }
+    };
+
+    // Writers to the same key take the same stripe while they update every
+    // replica, so two of them can't leave the copies disagreeing.
+    struct alignas(CacheLineSize) WriteStripe {
+        mutex stripeMutex;
+    };
+
+    vector<unique_ptr<Shard, ShardDeleter>> shards_;
+    NumaMode mode_;
+    Hash hash_;
+    unique_ptr<array<WriteStripe, ReplicaWriteStripes>> replicaWrites_;
+
+    // A different multiplier from the shards' Fibonacci bucket index, so the
+    // shard choice doesn't thin out the buckets each shard uses.
+    size_t shardFor(const Key& key) const {
+        uint64_t mixed = static_cast<uint64_t>(hash_(key)) * 0xBF58476D1CE4E5B9ull;
+        return static_cast<size_t>(mixed >> 32) % shards_.size();
+    }
+
+    size_t localShard() const {
+        return NumaTopology::current_node() % shards_.size();
+    }
+
+    mutex& writeStripe(const Key& key) {
+        return (*replicaWrites_)[static_cast<size_t>(hash_(key)) % ReplicaWriteStripes].stripeMutex;
+    }
+
+    template<typename F>
+    auto onShard(size_t node, F&& fn) {
+        NumaPlacement::Scope scope(node);
+        return fn(*shards_[node]);
+    }
+
+public:
+    explicit NumaShardedHashMap(NumaMode mode = NumaMode::Partitioned,
+                                const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : mode_(mode), hash_(hash) {
+        size_t nodes = NumaTopology::node_count();
+        shards_.reserve(nodes);
+        for (size_t node = 0; node < nodes; ++node) {
+            NumaPlacement::Scope scope(node);
+            void* memory = NumaTopology::allocate_on_node(shardBytes(), node);
+            try {
+                shards_.emplace_back(new (memory) Shard(hash, equal), ShardDeleter{node});
+            } catch (...) {
+                NumaTopology::release(memory, shardBytes());
+                throw;
+            }
+        }
+        if (mode_ == NumaMode::Replicated) {
+            replicaWrites_ = make_unique<array<WriteStripe, ReplicaWriteStripes>>();
+        }
+    }
+
+    NumaShardedHashMap(const NumaShardedHashMap&) = delete;
+    NumaShardedHashMap& operator = (const NumaShardedHashMap&) = delete;
+
+    NumaMode mode() const {
+        return mode_;
+    }
+
+    size_t node_count() const {
+        return shards_.size();
+    }
+
+    // Node whose memory holds `key`: its shard in Partitioned mode, the
+    // caller's own node in Replicated mode.
+    size_t home_node(const Key& key) const {
+        return mode_ == NumaMode::Partitioned ? shardFor(key) : localShard();
+    }
+
+    optional<Value> get(const Key& key) const {
+        return shards_[home_node(key)]->get(key);
+    }
+
+    bool contains(const Key& key) const {
+        return shards_[home_node(key)]->contains(key);
+    }
+
+    void put(const Key& key, const Value& value) {
+        if (mode_ == NumaMode::Partitioned) {
+            onShard(shardFor(key), [&](Shard& shard) { shard.put(key, value); });
+            return;
+        }
+        lock_guard lock(writeStripe(key));
+        for (size_t node = 0; node < shards_.size(); ++node) {
+            onShard(node, [&](Shard& shard) { shard.put(key, value); });
+        }
+    }
+
+    bool remove(const Key& key) {
+        if (mode_ == NumaMode::Partitioned) {
+            return onShard(shardFor(key), [&](Shard& shard) { return shard.remove(key); });
+        }
+        lock_guard lock(writeStripe(key));
+        bool removed = false;
+        for (size_t node = 0; node < shards_.size(); ++node) {
+            removed = onShard(node, [&](Shard& shard) { return shard.remove(key); }) || removed;
+        }
+        return removed;
+    }
+
+    size_t size() const {
+        if (mode_ == NumaMode::Replicated) {
+            return shards_[0]->size();
+        }
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard->size();
+        }
+        return total;
+    }
+
+    void clear() {
+        if (mode_ == NumaMode::Partitioned) {
+            for (size_t node = 0; node < shards_.size(); ++node) {
+                onShard(node, [](Shard& shard) { shard.clear(); });
+            }
+            return;
+        }
+        // Hold every stripe so no write lands on some replicas but not others.
+        vector<unique_lock<mutex>> locks;
+        locks.reserve(ReplicaWriteStripes);
+        for (auto& stripe : *replicaWrites_) {
+            locks.emplace_back(stripe.stripeMutex);
+        }
+        for (size_t node = 0; node < shards_.size(); ++node) {
+            onShard(node, [](Shard& shard) { shard.clear(); });
+        }
+    }
+};
+
+#endif // NUMA_HASHMAP_HPP
@@ -0,0 +1,207 @@
+#ifndef NUMA_TOPOLOGY_HPP
+#define NUMA_TOPOLOGY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Just enough NUMA support for the node-local pools and the NUMA-sharded
+// map, on raw syscalls and sysfs so nothing has to link against libnuma.
+// Everywhere but Linux, and on single-node machines, it reports one node
+// and placement is a no-op.
+//
+// Nodes are numbered densely, 0 to node_count() - 1, in the order of the
+// online node list. The kernel's ids can have gaps (online = "0,2"), and
+// node_id() maps back to them.
+class NumaTopology {
+public:
+    static size_t node_count() {
+        return topology().cpusByNode.size();
+    }
+
+    // The kernel's id for `node`, e.g. for numactl or /sys paths.
+    static int node_id(size_t node) {
+        const auto& ids = topology().nodeIds;
+        return node < ids.size() ? ids[node] : 0;
+    }
+
+    // Node of the CPU the calling thread is running on right now. Threads
+    // can migrate, so treat it as a hint.
+    static size_t current_node() {
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        const auto& nodes = topology().nodeByCpu;
+        if (cpu >= 0 && static_cast<size_t>(cpu) < nodes.size()) {
+            return nodes[cpu];
+        }
+#endif
+        return 0;
+    }
+
+    // Restricts the calling thread to the CPUs of `node`. Returns false if
+    // the platform doesn't support it or the node has no CPUs.
+    static bool pin_thread_to_node(size_t node) {
+#if defined(__linux__)
+        const auto& cpus = topology().cpusByNode;
+        if (node >= cpus.size() || cpus[node].empty()) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus[node]) {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)node;
+        return false;
+#endif
+    }
+
+    // Page-aligned memory whose pages the kernel prefers to place on `node`.
+    // If the policy can't be applied (e.g. seccomp blocks mbind) the memory
+    // is still returned, just without the placement. Free with release().
+    static void* allocate_on_node(size_t bytes, size_t node) {
+#if defined(__linux__)
+        void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw bad_alloc();
+        }
+        if (node_count() > 1 && node < node_count()) {
+            size_t id = static_cast<size_t>(node_id(node));
+            unsigned long mask[MaxNodes / (8 * sizeof(unsigned long))] = {};
+            mask[id / (8 * sizeof(unsigned long))] |= 1ul << (id % (8 * sizeof(unsigned long)));
+            syscall(SYS_mbind, ptr, bytes, MPOL_PREFERRED, mask, MaxNodes + 1, 0);
+        }
+        return ptr;
+#else
+        (void)node;
+        return ::operator new(bytes, align_val_t(PageSize));
+#endif
+    }
+
+    static void release(void* ptr, size_t bytes) noexcept {
+#if defined(__linux__)
+        munmap(ptr, bytes);
+#else
+        (void)bytes;
+        ::operator delete(ptr, align_val_t(PageSize));
+#endif
+    }
+
+private:
+    static constexpr size_t MaxNodes = 1024;
+    static constexpr size_t PageSize = 4096;
+
+    // Indexed by dense node number, except nodeByCpu, which is indexed by
+    // CPU and holds dense node numbers.
+    struct Layout {
+        vector<int> nodeIds;
+        vector<vector<int>> cpusByNode;
+        vector<size_t> nodeByCpu;
+    };
+
+    static const Layout& topology() {
+        static const Layout layout = discover();
+        return layout;
+    }
+
+    // Parses sysfs lists like "0-3,8-11".
+    static vector<int> parseList(const string& list) {
+        vector<int> values;
+        stringstream in(list);
+        string range;
+        while (getline(in, range, ',')) {
+            if (range.empty() || range == "\n") {
+                continue;
+            }
+            size_t dash = range.find('-');
+            int first = stoi(range.substr(0, dash));
+            int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+            for (int v = first; v <= last; ++v) {
+                values.push_back(v);
+            }
+        }
+        return values;
+    }
+
+    static string readFile(const string& path) {
+        ifstream file(path);
+        string contents;
+        getline(file, contents);
+        return contents;
+    }
+
+    static Layout discover() {
+        Layout layout;
+        vector<int> nodes = parseList(readFile("/sys/devices/system/node/online"));
+        for (int id : nodes) {
+            if (id < 0 || static_cast<size_t>(id) >= MaxNodes) {
+                continue;
+            }
+            size_t node = layout.nodeIds.size();
+            vector<int> cpus = parseList(readFile("/sys/devices/system/node/node" + to_string(id) + "/cpulist"));
+            for (int cpu : cpus) {
+                if (layout.nodeByCpu.size() <= static_cast<size_t>(cpu)) {
+                    layout.nodeByCpu.resize(cpu + 1, 0);
+                }
+                layout.nodeByCpu[cpu] = node;
+            }
+            layout.nodeIds.push_back(id);
+            layout.cpusByNode.push_back(std::move(cpus));
+        }
+        if (layout.cpusByNode.empty()) {
+            layout.nodeIds.push_back(0);
+            layout.cpusByNode.resize(1);
+        }
+        return layout;
+    }
+};
+
+// Which node's memory NumaAllocator serves the calling thread from. Defaults
+// to the node the thread is running on; a Scope overrides it, so a map can
+// keep a shard's allocations on the shard's node whoever calls into it.
+class NumaPlacement {
+public:
+    class Scope {
+    public:
+        explicit Scope(size_t node) : previous_(target()) {
+            target() = static_cast<long>(node);
+        }
+
+        ~Scope() {
+            target() = previous_;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        long previous_;
+    };
+
+    static size_t node() {
+        long node = target();
+        return node >= 0 ? static_cast<size_t>(node) : NumaTopology::current_node();
+    }
+
+private:
+    static long& target() {
+        thread_local long node = -1;
+        return node;
+    }
+};
+
+#endif // NUMA_TOPOLOGY_HPP
@@ -0,0 +1,244 @@
+#ifndef POOL_ALLOCATOR_HPP
+#define POOL_ALLOCATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "map_traits.hpp"
+#include "numa_topology.hpp"
+using namespace std;
+
+// Process-wide pool of small blocks, behind PoolAllocator.
+//
+// Requests up to MaxPooledSize bytes and up to cache-line alignment are
+// rounded up to a multiple of ClassSize (and of their alignment) and served
+// from per-size-class free lists. The free lists are
+// split into NumShards shards; every thread sticks to one shard, and a freed
+// block goes back to the freeing thread's shard, so a thread that keeps
+// replacing entries keeps reusing its own blocks. Empty free lists are
+// refilled a slab at a time from the system allocator, and slabs are never
+// given back - once the map has reached its working size, churn no longer
+// reaches malloc at all.
+class NodePool {
+public:
+    static constexpr size_t NumShards = 16;
+    static constexpr size_t ClassSize = 16;
+    static constexpr size_t MaxPooledSize = 1024;
+    static constexpr size_t SlabSize = 64 * 1024;
+
+    // Deliberately never destroyed, like EpochReclaimer: blocks can still be
+    // freed during static destruction.
+    static NodePool& instance() {
+        static NodePool* pool = new NodePool(-1);
+        return *pool;
+    }
+
+    // One more pool per NUMA node, whose slabs live in that node's memory.
+    // On a multi-node machine these also carve blocks up to MaxSlabBlock out
+    // of node slabs, in power-of-two classes, and give anything bigger whole
+    // pages on the node. With a single node they behave like instance().
+    static NodePool& for_node(size_t node) {
+        static const vector<NodePool*>* pools = [] {
+            auto* list = new vector<NodePool*>;
+            for (size_t n = 0; n < NumaTopology::node_count(); ++n) {
+                list->push_back(new NodePool(static_cast<long>(n)));
+            }
+            return list;
+        }();
+        return *(*pools)[node % pools->size()];
+    }
+
+    void* allocate(size_t bytes, size_t align) {
+        size_t cls = sizeClass(bytes, align);
+        if (cls == Unpooled) {
+            if (mapsPages(bytes, align)) {
+                return NumaTopology::allocate_on_node(pageRound(bytes), static_cast<size_t>(node_));
+            }
+            return ::operator new(bytes, align_val_t(align));
+        }
+        Shard& shard = localShard();
+        lock_guard lock(shard.listMutex);
+        if (!shard.free[cls]) {
+            refill(shard, cls);
+        }
+        FreeBlock* block = shard.free[cls];
+        shard.free[cls] = block->next;
+        return block;
+    }
+
+    void deallocate(void* ptr, size_t bytes, size_t align) noexcept {
+        size_t cls = sizeClass(bytes, align);
+        if (cls == Unpooled) {
+            if (mapsPages(bytes, align)) {
+                NumaTopology::release(ptr, pageRound(bytes));
+            } else {
+                ::operator delete(ptr, align_val_t(align));
+            }
+            return;
+        }
+        Shard& shard = localShard();
+        lock_guard lock(shard.listMutex);
+        auto* block = static_cast<FreeBlock*>(ptr);
+        block->next = shard.free[cls];
+        shard.free[cls] = block;
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+private:
+    static constexpr size_t NumClasses = MaxPooledSize / ClassSize;
+    static constexpr size_t PageSize = 4096;
+
+    // Placing pools add power-of-two classes from 2 * MaxPooledSize up to
+    // MaxSlabBlock, so a slab holds at least two blocks of the largest.
+    static constexpr size_t MaxSlabBlock = SlabSize / 2;
+    static constexpr size_t NumSlabClasses = 5;
+    static_assert((MaxPooledSize << NumSlabClasses) == MaxSlabBlock, "slab classes must end at MaxSlabBlock");
+    static constexpr size_t Unpooled = static_cast<size_t>(-1);
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct alignas(CacheLineSize) Shard {
+        mutex listMutex;
+        array<FreeBlock*, NumClasses + NumSlabClasses> free{};
+        vector<void*> slabs;
+    };
+
+    // node < 0 means no placement: slabs come from the system allocator.
+    // So does a node pool on a single-node machine, where placement would
+    // only add syscalls.
+    explicit NodePool(long node)
+        : node_(node), placing_(node >= 0 && NumaTopology::node_count() > 1) {}
+
+    static size_t pageRound(size_t bytes) {
+        return (bytes + PageSize - 1) & ~(PageSize - 1);
+    }
+
+    // Free-list index for a request, or Unpooled. Rounding the size up to a
+    // multiple of the alignment keeps every block of the class aligned,
+    // since slabs start on a cache line and blocks are packed back to back.
+    size_t sizeClass(size_t bytes, size_t align) const {
+        if (bytes == 0 || align > CacheLineSize) {
+            return Unpooled;
+        }
+        bytes = (bytes + align - 1) & ~(align - 1);
+        if (bytes <= MaxPooledSize) {
+            return (bytes - 1) / ClassSize;
+        }
+        if (!placing_ || bytes > MaxSlabBlock) {
+            return Unpooled;
+        }
+        size_t cls = NumClasses;
+        for (size_t size = 2 * MaxPooledSize; size < bytes; size *= 2) {
+            ++cls;
+        }
+        return cls;
+    }
+
+    static size_t blockSize(size_t cls) {
+        return cls < NumClasses ? (cls + 1) * ClassSize : MaxPooledSize << (cls - NumClasses + 1);
+    }
+
+    // Blocks past MaxSlabBlock on a placing pool: whole pages on the node.
+    bool mapsPages(size_t bytes, size_t align) const {
+        return placing_ && bytes > MaxSlabBlock && align <= PageSize;
+    }
+
+    Shard& localShard() {
+        thread_local size_t index = nextShard_.fetch_add(1, memory_order_relaxed) % NumShards;
+        return shards_[index];
+    }
+
+    // Caller holds shard.listMutex.
+    void refill(Shard& shard, size_t cls) {
+        size_t size = blockSize(cls);
+        void* slab = placing_ ? NumaTopology::allocate_on_node(SlabSize, static_cast<size_t>(node_))
+                              : ::operator new(SlabSize, align_val_t(CacheLineSize));
+        shard.slabs.push_back(slab);
+        auto* bytes = static_cast<unsigned char*>(slab);
+        for (size_t offset = 0; offset + size <= SlabSize; offset += size) {
+            auto* block = reinterpret_cast<FreeBlock*>(bytes + offset);
+            block->next = shard.free[cls];
+            shard.free[cls] = block;
+        }
+    }
+
+    const long node_;
+    const bool placing_;
+    array<Shard, NumShards> shards_;
+    atomic<size_t> nextShard_{0};
+};
+
+// Stateless standard allocator on top of NodePool. Every instance shares the
+// same pool, so any PoolAllocator can free what another one allocated.
+//
+//     LockFreeReadHashMap<int, double, 1024, PoolAllocator<pair<const int, double>>> prices;
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(NodePool::instance().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        NodePool::instance().deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+// PoolAllocator on the per-node pools: memory comes from the node
+// NumaPlacement names for the calling thread. Blocks should be freed under
+// the same placement they were allocated under; one freed elsewhere still
+// works, it just joins the other node's free list.
+template<typename T>
+class NumaAllocator {
+public:
+    using value_type = T;
+
+    NumaAllocator() noexcept = default;
+
+    template<typename U>
+    NumaAllocator(const NumaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(NodePool::for_node(NumaPlacement::node()).allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        NodePool::for_node(NumaPlacement::node()).deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const NumaAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const NumaAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+#endif // POOL_ALLOCATOR_HPP
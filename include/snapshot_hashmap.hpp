@@ -0,0 +1,332 @@
+#ifndef SNAPSHOT_HASHMAP_HPP
+#define SNAPSHOT_HASHMAP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "epoch_reclaimer.hpp"
+#include "string_hash.hpp"
+using namespace std;
+
+// Same get/put/remove API as ConcurrentHashMap, for reference data that is
+// loaded once and then changes a handful of times a day: instrument
+// definitions, limit tables.
+//
+// Readers load an atomic pointer to an immutable version of the map and look
+// the key up with plain loads - no lock, no shared writes, nothing but an
+// epoch pin. Writers serialize on one mutex, build the next version on the
+// side, publish it with a single store, and retire the old one to
+// EpochReclaimer, which frees it once no reader can still be looking at it.
+// Writes are rare and a version can hold a whole base table, so every
+// publish flushes the reclaimer instead of letting versions pile up until
+// its usual collect threshold.
+//
+// Copying the whole table for every put() would make writes O(n), so a
+// version is a large base table shared between versions plus a small delta
+// of changes (and tombstones) on top of it. A write copies only the delta.
+// Once the delta outgrows about sqrt(base) entries, the next write folds it
+// into a fresh base. Use update() to publish many changes as one version.
+template<typename Key, typename Value,
+         typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key>>
+class SnapshotHashMap {
+private:
+    static constexpr size_t MinDeltaLimit = 64;
+
+    // Open-addressing table built once and never modified. The index holds
+    // entry + 1 so that 0 means empty, and is kept at most half full. Hashes
+    // are kept next to the entries so the next version can reuse them.
+    template<typename Mapped>
+    class FrozenTable {
+    public:
+        using Entry = pair<Key, Mapped>;
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        FrozenTable() : FrozenTable({}, {}) {}
+
+        FrozenTable(vector<Entry> entries, vector<size_t> hashes)
+            : entries_(std::move(entries)), hashes_(std::move(hashes)) {
+            size_t capacity = 2;
+            shift_ = 63;
+            while (capacity < entries_.size() * 2) {
+                capacity <<= 1;
+                --shift_;
+            }
+            index_.assign(capacity, 0);
+            for (size_t i = 0; i < entries_.size(); ++i) {
+                size_t s = home(hashes_[i]);
+                while (index_[s] != 0) {
+                    s = (s + 1) & (capacity - 1);
+                }
+                index_[s] = static_cast<uint32_t>(i + 1);
+            }
+        }
+
+        size_t indexOf(const Key& key, size_t hash, const KeyEqual& eq) const {
+            size_t mask = index_.size() - 1;
+            for (size_t s = home(hash);; s = (s + 1) & mask) {
+                uint32_t entry = index_[s];
+                if (entry == 0) {
+                    return npos;
+                }
+                if (hashes_[entry - 1] == hash && eq(entries_[entry - 1].first, key)) {
+                    return entry - 1;
+                }
+            }
+        }
+
+        const Mapped* find(const Key& key, size_t hash, const KeyEqual& eq) const {
+            size_t i = indexOf(key, hash, eq);
+            return i == npos ? nullptr : &entries_[i].second;
+        }
+
+        const vector<Entry>& entries() const {
+            return entries_;
+        }
+
+        const vector<size_t>& hashes() const {
+            return hashes_;
+        }
+
+    private:
+        size_t home(size_t hash) const {
+            return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        vector<Entry> entries_;
+        vector<size_t> hashes_;
+        vector<uint32_t> index_;
+        unsigned shift_;
+    };
+
+    using Base = FrozenTable<Value>;
+    using Delta = FrozenTable<optional<Value>>;  // nullopt marks a removal
+
+    struct Version {
+        shared_ptr<const Base> base;
+        Delta delta;
+        size_t size;
+    };
+
+    // Pending changes while a writer builds the next version.
+    using Edits = unordered_map<Key, optional<Value>, Hash, KeyEqual>;
+
+    atomic<Version*> current_;
+    mutex writeMutex_;
+    Hash hash_;
+    KeyEqual equal_;
+
+    // Caller must hold an EpochReclaimer::Guard.
+    const Value* find(const Version& version, const Key& key) const {
+        size_t hash = hash_(key);
+        if (const optional<Value>* change = version.delta.find(key, hash, equal_)) {
+            return change->has_value() ? &**change : nullptr;
+        }
+        return version.base->find(key, hash, equal_);
+    }
+
+    // A write copies the delta and a fold copies the base, so letting the
+    // delta reach sqrt(base) entries keeps the average cost per write at
+    // about sqrt(base) entry copies.
+    static size_t deltaLimit(size_t baseSize) {
+        size_t limit = MinDeltaLimit;
+        while (limit * limit < baseSize) {
+            limit *= 2;
+        }
+        return limit;
+    }
+
+    // Applies `edits` on top of the current version and publishes the
+    // result. Caller must hold writeMutex_.
+    void publish(Edits& edits) {
+        Version* old = current_.load(memory_order_relaxed);
+        const Base& base = *old->base;
+
+        // Start from a copy of the old delta; new edits overwrite or extend it.
+        size_t size = old->size;
+        vector<typename Delta::Entry> delta = old->delta.entries();
+        vector<size_t> hashes = old->delta.hashes();
+        vector<bool> dropped(delta.size(), false);
+        for (auto& [key, change] : edits) {
+            size_t hash = hash_(key);
+            size_t i = old->delta.indexOf(key, hash, equal_);
+            bool inBase = base.find(key, hash, equal_) != nullptr;
+            bool present = i != Delta::npos ? delta[i].second.has_value() : inBase;
+            if (present && !change) {
+                --size;
+            } else if (!present && change) {
+                ++size;
+            }
+            if (i != Delta::npos) {
+                delta[i].second = std::move(change);
+                // A tombstone over nothing in the base needn't be kept.
+                dropped[i] = !delta[i].second && !inBase;
+            } else if (change || inBase) {
+                delta.emplace_back(key, std::move(change));
+                hashes.push_back(hash);
+                dropped.push_back(false);
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < delta.size(); ++i) {
+            if (!dropped[i]) {
+                if (kept != i) {
+                    delta[kept] = std::move(delta[i]);
+                    hashes[kept] = hashes[i];
+                }
+                ++kept;
+            }
+        }
+        delta.resize(kept);
+        hashes.resize(kept);
+
+        auto* next = new Version{old->base, Delta(), size};
+        if (delta.size() > deltaLimit(base.entries().size())) {
+            Delta changes(std::move(delta), std::move(hashes));
+            vector<typename Base::Entry> entries;
+            vector<size_t> entryHashes;
+            entries.reserve(size);
+            entryHashes.reserve(size);
+            for (size_t i = 0; i < base.entries().size(); ++i) {
+                const auto& entry = base.entries()[i];
+                if (changes.indexOf(entry.first, base.hashes()[i], equal_) == Delta::npos) {
+                    entries.push_back(entry);
+                    entryHashes.push_back(base.hashes()[i]);
+                }
+            }
+            for (size_t i = 0; i < changes.entries().size(); ++i) {
+                const auto& [key, change] = changes.entries()[i];
+                if (change) {
+                    entries.emplace_back(key, *change);
+                    entryHashes.push_back(changes.hashes()[i]);
+                }
+            }
+            next->base = make_shared<const Base>(std::move(entries), std::move(entryHashes));
+        } else {
+            next->delta = Delta(std::move(delta), std::move(hashes));
+        }
+
+        current_.store(next, memory_order_release);
+        retire(old);
+    }
+
+    static void retire(Version* old) {
+        EpochReclaimer& reclaimer = EpochReclaimer::instance();
+        reclaimer.retire(old);
+        reclaimer.flush();
+    }
+
+public:
+    // Collects the changes made inside update(); they become visible to
+    // readers all at once when the callback returns.
+    class Batch {
+    public:
+        void put(const Key& key, const Value& value) {
+            edits_.insert_or_assign(key, value);
+        }
+
+        void remove(const Key& key) {
+            edits_.insert_or_assign(key, nullopt);
+        }
+
+    private:
+        friend class SnapshotHashMap;
+
+        Batch(const Hash& hash, const KeyEqual& eq) : edits_(0, hash, eq) {}
+
+        Edits edits_;
+    };
+
+    explicit SnapshotHashMap(const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+        : current_(new Version{make_shared<const Base>(), Delta(), 0}), hash_(hash), equal_(eq) {}
+
+    ~SnapshotHashMap() {
+        delete current_.load(memory_order_relaxed);
+    }
+
+    SnapshotHashMap(const SnapshotHashMap&) = delete;
+    SnapshotHashMap& operator = (const SnapshotHashMap&) = delete;
+
+    optional<Value> get(const Key& key) const {
+        EpochReclaimer::Guard guard;
+        if (const Value* value = find(*current_.load(memory_order_acquire), key)) {
+            return *value;
+        }
+        return nullopt;
+    }
+
+    bool contains(const Key& key) const {
+        EpochReclaimer::Guard guard;
+        return find(*current_.load(memory_order_acquire), key) != nullptr;
+    }
+
+    void put(const Key& key, const Value& value) {
+        lock_guard lock(writeMutex_);
+        Edits edits(1, hash_, equal_);
+        edits.emplace(key, value);
+        publish(edits);
+    }
+
+    bool remove(const Key& key) {
+        lock_guard lock(writeMutex_);
+        // Only writers retire versions, so the current one is safe to read
+        // under the write mutex.
+        if (!find(*current_.load(memory_order_relaxed), key)) {
+            return false;
+        }
+        Edits edits(1, hash_, equal_);
+        edits.emplace(key, nullopt);
+        publish(edits);
+        return true;
+    }
+
+    // Runs edit(batch) and publishes everything it put or removed as one
+    // new version, e.g. for a start-of-day reload.
+    template<typename F>
+    void update(F&& edit) {
+        Batch batch(hash_, equal_);
+        edit(batch);
+        if (batch.edits_.empty()) {
+            return;
+        }
+        lock_guard lock(writeMutex_);
+        publish(batch.edits_);
+    }
+
+    size_t size() const {
+        EpochReclaimer::Guard guard;
+        return current_.load(memory_order_acquire)->size;
+    }
+
+    // Calls fn(key, value) for every entry of one version: the walk sees a
+    // consistent point-in-time view no matter what writers do meanwhile.
+    template<typename F>
+    void for_each_const(F&& fn) const {
+        EpochReclaimer::Guard guard;
+        const Version& version = *current_.load(memory_order_acquire);
+        for (const auto& [key, change] : version.delta.entries()) {
+            if (change) {
+                fn(key, *change);
+            }
+        }
+        for (const auto& [key, value] : version.base->entries()) {
+            if (!version.delta.find(key, hash_(key), equal_)) {
+                fn(key, value);
+            }
+        }
+    }
+
+    void clear() {
+        lock_guard lock(writeMutex_);
+        Version* old = current_.load(memory_order_relaxed);
+        current_.store(new Version{make_shared<const Base>(), Delta(), 0}, memory_order_release);
+        retire(old);
+    }
+};
+
+#endif // SNAPSHOT_HASHMAP_HPP
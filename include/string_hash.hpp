@@ -0,0 +1,30 @@
+#ifndef STRING_HASH_HPP
+#define STRING_HASH_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+using namespace std;
+
+// Transparent hash for string keys: std::string, std::string_view and
+// const char* all hash through string_view, so a lookup with a view into a
+// message buffer never has to build a temporary std::string.
+struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(string_view s) const {
+        return hash<string_view>{}(s);
+    }
+};
+
+// Defaults used by ConcurrentHashMap: string keys get transparent hashing and
+// comparison out of the box, everything else uses the standard functors.
+template<typename Key>
+using DefaultHash = conditional_t<is_same_v<Key, string>, StringHash, hash<Key>>;
+
+template<typename Key>
+using DefaultKeyEqual = conditional_t<is_same_v<Key, string>, equal_to<>, equal_to<Key>>;
+
+#endif // STRING_HASH_HPP
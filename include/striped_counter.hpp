@@ -0,0 +1,94 @@
+#ifndef STRIPED_COUNTER_HPP
+#define STRIPED_COUNTER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "map_traits.hpp"
+using namespace std;
+
+// Element counter split into cache-line sized stripes so that writers on
+// different threads never bump the same atomic.
+//
+// Each thread sticks to one stripe. A stripe keeps two monotonic totals,
+// entries added and entries removed, instead of a single net value: an
+// entry may be removed on a different stripe from the one that added it,
+// and because neither total ever goes back down, reading the same numbers
+// twice proves nothing changed in between.
+class StripedCounter {
+public:
+    static constexpr size_t Stripes = 16;
+
+    // Returns the calling thread's stripe total before and after the add, so
+    // callers can sample the full sum every so many inserts.
+    pair<uint64_t, uint64_t> add(size_t n) {
+        uint64_t before = localStripe().added.fetch_add(n, memory_order_relaxed);
+        return {before, before + n};
+    }
+
+    void subtract(size_t n) {
+        localStripe().removed.fetch_add(n, memory_order_relaxed);
+    }
+
+    // Sum of all stripes without any coordination. Can be off by whatever is
+    // in flight while it runs, in either direction: the map counts after it
+    // has released the bucket lock, so a remove can reach its stripe before
+    // the add it undoes reaches another one. A transient undercount below
+    // zero is clamped to 0.
+    size_t approximate() const {
+        uint64_t added = 0;
+        uint64_t removed = 0;
+        for (const auto& stripe : stripes_) {
+            added += stripe.added.load(memory_order_relaxed);
+            removed += stripe.removed.load(memory_order_relaxed);
+        }
+        return added > removed ? static_cast<size_t>(added - removed) : 0;
+    }
+
+    // Double collect: reads every stripe twice and succeeds only if nothing
+    // moved in between, in which case the total is the exact count at the
+    // moment between the two passes.
+    bool trySnapshot(size_t& total) const {
+        array<uint64_t, Stripes> added;
+        array<uint64_t, Stripes> removed;
+        for (size_t i = 0; i < Stripes; ++i) {
+            added[i] = stripes_[i].added.load(memory_order_acquire);
+            removed[i] = stripes_[i].removed.load(memory_order_acquire);
+        }
+        uint64_t sumAdded = 0;
+        uint64_t sumRemoved = 0;
+        for (size_t i = 0; i < Stripes; ++i) {
+            if (stripes_[i].added.load(memory_order_acquire) != added[i] ||
+                stripes_[i].removed.load(memory_order_acquire) != removed[i]) {
+                return false;
+            }
+            sumAdded += added[i];
+            sumRemoved += removed[i];
+        }
+        total = sumAdded > sumRemoved ? static_cast<size_t>(sumAdded - sumRemoved) : 0;
+        return true;
+    }
+
+    // Stripe the calling thread uses, handed out round-robin on first use.
+    static size_t stripeIndex() {
+        static atomic<size_t> nextStripe{0};
+        thread_local size_t index = nextStripe.fetch_add(1, memory_order_relaxed) % Stripes;
+        return index;
+    }
+
+private:
+    struct alignas(CacheLineSize) Stripe {
+        atomic<uint64_t> added{0};
+        atomic<uint64_t> removed{0};
+    };
+
+    Stripe& localStripe() {
+        return stripes_[stripeIndex()];
+    }
+
+    array<Stripe, Stripes> stripes_;
+};
+
+#endif // STRIPED_COUNTER_HPP
@@ -0,0 +1,429 @@
+#ifndef SWISS_HASHMAP_HPP
+#define SWISS_HASHMAP_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include "map_traits.hpp"
+#include "string_hash.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// One 16-slot group of control bytes. Each byte is either Empty, Deleted, or
+// the low 7 bits of the hash (the "tag") of the entry in that slot. Matching
+// a tag against the whole group is one SSE2 compare plus a movemask; without
+// SSE2 it is the same test done bytewise on two 64-bit words.
+class SwissGroup {
+public:
+    static constexpr size_t Width = 16;
+    static constexpr int8_t Empty = -128;   // 0b10000000
+    static constexpr int8_t Deleted = -2;   // 0b11111110
+
+    explicit SwissGroup(const int8_t* ctrl) {
+#if defined(__SSE2__)
+        ctrl_ = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        for (size_t i = 0; i < Width; ++i) {
+            words_[i / 8] |= static_cast<uint64_t>(static_cast<uint8_t>(ctrl[i])) << (8 * (i % 8));
+        }
+#endif
+    }
+
+    // Bit i is set when slot i holds the given tag.
+    uint32_t match(uint8_t tag) const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(tag)), ctrl_)));
+#else
+        return matchByte(tag);
+#endif
+    }
+
+    uint32_t matchEmpty() const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Empty), ctrl_)));
+#else
+        return matchByte(static_cast<uint8_t>(Empty));
+#endif
+    }
+
+    // Empty and Deleted are the only control bytes with the sign bit set.
+    uint32_t matchEmptyOrDeleted() const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+        return packHighBits(words_[0] & HighBits) | packHighBits(words_[1] & HighBits) << 8;
+#endif
+    }
+
+private:
+#if defined(__SSE2__)
+    __m128i ctrl_;
+#else
+    static constexpr uint64_t LowBits = 0x7F7F7F7F7F7F7F7Full;
+    static constexpr uint64_t HighBits = ~LowBits;
+
+    // High bit set in every byte of x that is zero. Exact, unlike the
+    // shorter (x - 0x0101...) & ~x form, whose borrows can flag the byte
+    // above a zero one - harmless for tags, wrong for matchEmpty().
+    static uint64_t zeroBytes(uint64_t x) {
+        return ~(((x & LowBits) + LowBits) | x) & HighBits;
+    }
+
+    // Gathers the high bits of the 8 bytes into bits 0-7, byte 0 first. The
+    // shifted copies the multiply adds never overlap, so nothing carries.
+    static uint32_t packHighBits(uint64_t x) {
+        return static_cast<uint32_t>(((x >> 7) * 0x0102040810204080ull) >> 56);
+    }
+
+    uint32_t matchByte(uint8_t byte) const {
+        uint64_t pattern = 0x0101010101010101ull * byte;
+        return packHighBits(zeroBytes(words_[0] ^ pattern)) | packHighBits(zeroBytes(words_[1] ^ pattern)) << 8;
+    }
+
+    uint64_t words_[2] = {};  // slot i is byte i % 8 of words_[i / 8]
+#endif
+};
+
+// Same API as ConcurrentHashMap, backed by open addressing in the style of
+// SwissTable/F14 instead of per-bucket chains.
+//
+// The key space is split into NumShards shards, each with its own
+// reader-writer lock and its own flat table. A table is an array of 16-slot
+// groups; a lookup hashes once, jumps to a group and compares the key's 7-bit
+// tag against all 16 control bytes at once. Only slots whose tag matches get
+// a real key comparison, and a group with an empty slot ends the probe, so a
+// miss usually costs one vector compare on one cache line.
+//
+// Each shard grows on its own (doubling at 7/8 full) under its own lock.
+template<typename Key, typename Value, size_t NumShards = 64,
+         typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key>>
+class SwissHashMap {
+private:
+    static_assert(NumShards > 0 && (NumShards & (NumShards - 1)) == 0,
+                  "NumShards must be a power of two");
+
+    static constexpr size_t Width = SwissGroup::Width;
+    static constexpr size_t MinCapacity = Width;
+
+    using Entry = pair<Key, Value>;
+
+    struct alignas(Width) ControlBlock {
+        int8_t bytes[Width];
+    };
+
+    struct Slot {
+        alignas(Entry) unsigned char bytes[sizeof(Entry)];
+
+        Entry& entry() {
+            return *std::launder(reinterpret_cast<Entry*>(bytes));
+        }
+
+        const Entry& entry() const {
+            return *std::launder(reinterpret_cast<const Entry*>(bytes));
+        }
+    };
+
+    class Table {
+    public:
+        Table() = default;
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+
+        ~Table() {
+            destroyAll();
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        template<typename K>
+        const Entry* find(const K& key, uint64_t hash, const KeyEqual& eq) const {
+            if (capacity_ == 0) {
+                return nullptr;
+            }
+            size_t slot = findSlot(key, hash, eq);
+            return slot == NotFound ? nullptr : &slots_[slot].entry();
+        }
+
+        template<typename K>
+        Entry* find(const K& key, uint64_t hash, const KeyEqual& eq) {
+            return const_cast<Entry*>(std::as_const(*this).find(key, hash, eq));
+        }
+
+        // Adds an entry for a key the caller has checked is absent.
+        template<typename K, typename V>
+        Entry& insert(K&& key, V&& value, uint64_t hash, const Hash& hasher) {
+            if ((size_ + tombstones_ + 1) * 8 > capacity_ * 7) {
+                rehash(size_ * 2 + 1 > capacity_ * 7 / 8 ? capacity_ * 2 : capacity_, hasher);
+            }
+            size_t slot = findInsertSlot(hash);
+            ::new (static_cast<void*>(slots_[slot].bytes)) Entry(std::forward<K>(key), std::forward<V>(value));
+            if (ctrl_[slot / Width].bytes[slot % Width] == SwissGroup::Deleted) {
+                --tombstones_;
+            }
+            setCtrl(slot, tagOf(hash));
+            ++size_;
+            return slots_[slot].entry();
+        }
+
+        template<typename K>
+        bool erase(const K& key, uint64_t hash, const KeyEqual& eq) {
+            if (capacity_ == 0) {
+                return false;
+            }
+            size_t slot = findSlot(key, hash, eq);
+            if (slot == NotFound) {
+                return false;
+            }
+            slots_[slot].entry().~Entry();
+            --size_;
+            // If the group still has an empty slot, no probe ever walked past
+            // it, so the slot can go straight back to Empty.
+            SwissGroup group(ctrl_[slot / Width].bytes);
+            if (group.matchEmpty()) {
+                setCtrl(slot, SwissGroup::Empty);
+            } else {
+                setCtrl(slot, SwissGroup::Deleted);
+                ++tombstones_;
+            }
+            return true;
+        }
+
+        void clear() {
+            destroyAll();
+            ctrl_.reset();
+            slots_.reset();
+            capacity_ = size_ = tombstones_ = 0;
+        }
+
+    private:
+        static constexpr size_t NotFound = static_cast<size_t>(-1);
+
+        static uint8_t tagOf(uint64_t hash) {
+            return static_cast<uint8_t>(hash & 0x7F);
+        }
+
+        size_t groupCount() const {
+            return capacity_ / Width;
+        }
+
+        size_t firstGroup(uint64_t hash) const {
+            return static_cast<size_t>(hash >> 7) & (groupCount() - 1);
+        }
+
+        void setCtrl(size_t slot, int8_t value) {
+            ctrl_[slot / Width].bytes[slot % Width] = value;
+        }
+
+        template<typename K>
+        size_t findSlot(const K& key, uint64_t hash, const KeyEqual& eq) const {
+            uint8_t tag = tagOf(hash);
+            size_t mask = groupCount() - 1;
+            size_t g = firstGroup(hash);
+            for (size_t probe = 0; probe < groupCount(); ++probe, g = (g + 1) & mask) {
+                SwissGroup group(ctrl_[g].bytes);
+                for (uint32_t bits = group.match(tag); bits; bits &= bits - 1) {
+                    size_t slot = g * Width + static_cast<size_t>(__builtin_ctz(bits));
+                    if (eq(slots_[slot].entry().first, key)) {
+                        return slot;
+                    }
+                }
+                if (group.matchEmpty()) {
+                    return NotFound;
+                }
+            }
+            return NotFound;
+        }
+
+        size_t findInsertSlot(uint64_t hash) const {
+            size_t mask = groupCount() - 1;
+            size_t g = firstGroup(hash);
+            for (;; g = (g + 1) & mask) {
+                uint32_t bits = SwissGroup(ctrl_[g].bytes).matchEmptyOrDeleted();
+                if (bits) {
+                    return g * Width + static_cast<size_t>(__builtin_ctz(bits));
+                }
+            }
+        }
+
+        void rehash(size_t newCapacity, const Hash& hasher) {
+            newCapacity = max(newCapacity, MinCapacity);
+            // Allocate everything before touching the shard, so a bad_alloc
+            // leaves the old arrays and their entries in place.
+            unique_ptr<ControlBlock[]> newCtrl(new ControlBlock[newCapacity / Width]);
+            unique_ptr<Slot[]> newSlots(new Slot[newCapacity]);
+            memset(newCtrl.get(), static_cast<unsigned char>(SwissGroup::Empty), newCapacity);
+            unique_ptr<ControlBlock[]> oldCtrl = exchange(ctrl_, std::move(newCtrl));
+            unique_ptr<Slot[]> oldSlots = exchange(slots_, std::move(newSlots));
+            size_t oldCapacity = capacity_;
+            capacity_ = newCapacity;
+            tombstones_ = 0;
+
+            for (size_t i = 0; i < oldCapacity; ++i) {
+                if (oldCtrl[i / Width].bytes[i % Width] >= 0) {
+                    Entry& old = oldSlots[i].entry();
+                    uint64_t hash = mixHash(hasher(old.first));
+                    size_t slot = findInsertSlot(hash);
+                    ::new (static_cast<void*>(slots_[slot].bytes)) Entry(std::move(old));
+                    setCtrl(slot, tagOf(hash));
+                    old.~Entry();
+                }
+            }
+        }
+
+        void destroyAll() {
+            for (size_t i = 0; i < capacity_; ++i) {
+                if (ctrl_[i / Width].bytes[i % Width] >= 0) {
+                    slots_[i].entry().~Entry();
+                }
+            }
+        }
+
+        unique_ptr<ControlBlock[]> ctrl_;
+        unique_ptr<Slot[]> slots_;
+        size_t capacity_ = 0;
+        size_t size_ = 0;
+        size_t tombstones_ = 0;
+    };
+
+    struct alignas(CacheLineSize) Shard {
+        mutable shared_mutex mutex;
+        Table table;
+    };
+
+    array<Shard, NumShards> shards_;
+    Hash hash_;
+    KeyEqual equal_;
+
+    // Heterogeneous lookup is on when both functors declare is_transparent,
+    // as in ConcurrentHashMap.
+    template<typename T, typename = void>
+    struct HasTransparentTag : false_type {};
+
+    template<typename T>
+    struct HasTransparentTag<T, void_t<typename T::is_transparent>> : true_type {};
+
+    template<typename K>
+    static constexpr bool IsLookupKey =
+        HasTransparentTag<Hash>::value && HasTransparentTag<KeyEqual>::value &&
+        !is_same_v<decay_t<K>, Key>;
+
+    // Tags, group index and shard all come from different bits, so the raw
+    // hash has to be well mixed; std::hash<int> is the identity.
+    static uint64_t mixHash(size_t hash) {
+        uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+        return mixed ^ (mixed >> 32);
+    }
+
+    static Shard& shardFor(array<Shard, NumShards>& shards, uint64_t hash) {
+        return shards[(hash >> 40) & (NumShards - 1)];
+    }
+
+    static const Shard& shardFor(const array<Shard, NumShards>& shards, uint64_t hash) {
+        return shards[(hash >> 40) & (NumShards - 1)];
+    }
+
+    template<typename K>
+    optional<Value> getImpl(const K& key) const {
+        uint64_t hash = mixHash(hash_(key));
+        const Shard& shard = shardFor(shards_, hash);
+        shared_lock lock(shard.mutex);
+        if (const Entry* entry = shard.table.find(key, hash, equal_)) {
+            return entry->second;
+        }
+        return nullopt;
+    }
+
+    template<typename K>
+    bool containsImpl(const K& key) const {
+        uint64_t hash = mixHash(hash_(key));
+        const Shard& shard = shardFor(shards_, hash);
+        shared_lock lock(shard.mutex);
+        return shard.table.find(key, hash, equal_) != nullptr;
+    }
+
+    template<typename K>
+    bool removeImpl(const K& key) {
+        uint64_t hash = mixHash(hash_(key));
+        Shard& shard = shardFor(shards_, hash);
+        unique_lock lock(shard.mutex);
+        return shard.table.erase(key, hash, equal_);
+    }
+
+public:
+    explicit SwissHashMap(const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : hash_(hash), equal_(equal) {}
+
+    SwissHashMap(const SwissHashMap&) = delete;
+    SwissHashMap& operator = (const SwissHashMap&) = delete;
+
+    optional<Value> get(const Key& key) const {
+        return getImpl(key);
+    }
+
+    // Lookup by anything the transparent Hash/KeyEqual accept, e.g. a
+    // string_view or const char* for string keys.
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    optional<Value> get(const K& key) const {
+        return getImpl(key);
+    }
+
+    bool contains(const Key& key) const {
+        return containsImpl(key);
+    }
+
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    bool contains(const K& key) const {
+        return containsImpl(key);
+    }
+
+    template<typename V = Value>
+    void put(const Key& key, V&& value) {
+        uint64_t hash = mixHash(hash_(key));
+        Shard& shard = shardFor(shards_, hash);
+        unique_lock lock(shard.mutex);
+        if (Entry* entry = shard.table.find(key, hash, equal_)) {
+            entry->second = std::forward<V>(value);
+            return;
+        }
+        shard.table.insert(key, std::forward<V>(value), hash, hash_);
+    }
+
+    bool remove(const Key& key) {
+        return removeImpl(key);
+    }
+
+    template<typename K, typename = enable_if_t<IsLookupKey<K>>>
+    bool remove(const K& key) {
+        return removeImpl(key);
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            shared_lock lock(shard.mutex);
+            total += shard.table.size();
+        }
+        return total;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            unique_lock lock(shard.mutex);
+            shard.table.clear();
+        }
+    }
+};
+
+#endif // SWISS_HASHMAP_HPP
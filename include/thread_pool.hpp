@@ -0,0 +1,201 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "map_traits.hpp"
+using namespace std;
+
+// Small work-stealing pool for the map's parallel traversals.
+//
+// Every worker owns a queue. A worker takes its own newest task first and,
+// when its queue runs dry, steals the oldest task from another queue, so
+// uneven chunks (a few hot buckets) even out on their own. The thread that
+// calls parallel_for works through tasks too instead of blocking, which also
+// makes nested parallel_for calls from inside a task safe.
+class ThreadPool {
+public:
+    // Workers default to one less than the core count; the calling thread
+    // makes up the difference.
+    explicit ThreadPool(size_t threads = defaultThreadCount())
+        : queues_(max<size_t>(threads, 1)) {
+        size_t count = queues_.size();
+        workers_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            workers_.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard lock(sleepMutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool used when a map's parallel_* call isn't given one.
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t thread_count() const {
+        return workers_.size();
+    }
+
+    // Runs fn(i) for every i in [0, count) and returns once all of them have
+    // finished. If any call throws, the first exception is rethrown here
+    // after the rest have run.
+    template<typename F>
+    void parallel_for(size_t count, F&& fn) {
+        if (count == 0) {
+            return;
+        }
+        auto job = make_shared<Job>();
+        job->remaining.store(count, memory_order_relaxed);
+
+        size_t home = localQueue();
+        for (size_t i = 0; i < count; ++i) {
+            push((home + i) % queues_.size(), [job, &fn, i]() {
+                try {
+                    fn(i);
+                } catch (...) {
+                    lock_guard lock(job->doneMutex);
+                    if (!job->error) {
+                        job->error = current_exception();
+                    }
+                }
+                if (job->remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+                    lock_guard lock(job->doneMutex);
+                    job->done.notify_all();
+                }
+            });
+        }
+
+        while (job->remaining.load(memory_order_acquire) > 0) {
+            if (!runOne(home)) {
+                unique_lock lock(job->doneMutex);
+                job->done.wait(lock, [&] {
+                    return job->remaining.load(memory_order_acquire) == 0 ||
+                           queued_.load(memory_order_acquire) > 0;
+                });
+            }
+        }
+        if (job->error) {
+            rethrow_exception(job->error);
+        }
+    }
+
+private:
+    using Task = function<void()>;
+
+    struct alignas(CacheLineSize) WorkQueue {
+        mutex queueMutex;
+        deque<Task> tasks;
+    };
+
+    struct Job {
+        atomic<size_t> remaining{0};
+        mutex doneMutex;
+        condition_variable done;
+        exception_ptr error;
+    };
+
+    static size_t defaultThreadCount() {
+        unsigned cores = thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+    // Workers submit to their own queue; outside threads start at queue 0.
+    size_t localQueue() const {
+        return workerPool() == this ? workerIndex() : 0;
+    }
+
+    static const ThreadPool*& workerPool() {
+        thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& workerIndex() {
+        thread_local size_t index = 0;
+        return index;
+    }
+
+    void push(size_t queue, Task task) {
+        {
+            lock_guard lock(queues_[queue].queueMutex);
+            queues_[queue].tasks.push_back(std::move(task));
+        }
+        queued_.fetch_add(1, memory_order_release);
+        {
+            lock_guard lock(sleepMutex_);
+        }
+        wake_.notify_one();
+    }
+
+    // Pops from the back of our own queue, else steals from the front of the
+    // others'. Returns false if every queue was empty.
+    bool runOne(size_t home) {
+        Task task;
+        for (size_t k = 0; k < queues_.size() && !task; ++k) {
+            WorkQueue& queue = queues_[(home + k) % queues_.size()];
+            lock_guard lock(queue.queueMutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+        if (!task) {
+            return false;
+        }
+        queued_.fetch_sub(1, memory_order_acq_rel);
+        task();
+        return true;
+    }
+
+    void workerLoop(size_t index) {
+        workerPool() = this;
+        workerIndex() = index;
+        for (;;) {
+            if (runOne(index)) {
+                continue;
+            }
+            unique_lock lock(sleepMutex_);
+            wake_.wait(lock, [&] { return stop_ || queued_.load(memory_order_acquire) > 0; });
+            if (stop_) {
+                return;
+            }
+        }
+    }
+
+    vector<WorkQueue> queues_;
+    vector<thread> workers_;
+    atomic<size_t> queued_{0};
+    mutex sleepMutex_;
+    condition_variable wake_;
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_HPP
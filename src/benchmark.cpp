@@ -1,4 +1,10 @@
+#include "../include/atomic_flat_hashmap.hpp"
 #include "../include/concurrent_hashmap.hpp"
+#include "../include/lockfree_read_hashmap.hpp"
+#include "../include/numa_hashmap.hpp"
+#include "../include/pool_allocator.hpp"
+#include "../include/snapshot_hashmap.hpp"
+#include "../include/swiss_hashmap.hpp"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -8,6 +14,7 @@
 #include <random>
 #include <iomanip>
 #include <atomic>
+#include <algorithm>
 
 // Baseline comparison: unordered_map with global mutex
 template<typename Key, typename Value>
@@ -44,6 +51,54 @@ struct BenchmarkConfig {
     double read_ratio = 0.7;  // 70% reads, 30% writes
 };
 
+// Per-bucket overflow tables instead of map-wide resizes
+struct SegmentedTraits : DefaultMapTraits {
+    static constexpr bool SegmentedBuckets = true;
+};
+
+struct StatsTraits : DefaultMapTraits {
+    static constexpr bool CollectStats = true;
+};
+
+struct CombiningTraits : DefaultMapTraits {
+    static constexpr bool FlatCombining = true;
+};
+
+struct HotKeyTraits : DefaultMapTraits {
+    static constexpr bool HotKeyReplicas = true;
+};
+
+template<typename Lock>
+struct LockTraits : DefaultMapTraits {
+    using BucketLock = Lock;
+};
+
+// The original `hash % bucket_count` indexing, for comparison with the default
+// Fibonacci-mixed power-of-two mask
+struct ModuloTraits : DefaultMapTraits {
+    static constexpr bool FibonacciIndexing = false;
+};
+
+// Bucket layout without cache-line padding, for the false-sharing comparison.
+// Modulo indexing keeps key t in bucket t, so neighbouring keys really do sit
+// in neighbouring buckets.
+struct PackedModuloTraits : ModuloTraits {
+    static constexpr bool AlignBuckets = false;
+};
+
+void reportResults(std::chrono::milliseconds duration, long long total_ops) {
+    // Calculate metrics
+    double throughput = (total_ops * 1000.0) / std::max<long long>(duration.count(), 1);
+    double latency_us = (duration.count() * 1000.0) / total_ops;
+
+    std::cout << "Duration: " << duration.count() << " ms" << std::endl;
+    std::cout << "Total operations: " << total_ops << std::endl;
+    std::cout << "Throughput: " << std::fixed << std::setprecision(2)
+              << (throughput / 1000000.0) << "M ops/sec" << std::endl;
+    std::cout << "Average latency: " << std::fixed << std::setprecision(2)
+              << latency_us << " μs" << std::endl;
+}
+
 // Run benchmark on any map implementation
 template<typename HashMap>
 void runBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
@@ -94,18 +149,417 @@ void runBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig&
     }
 
     auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+}
 
-    // Calculate metrics
-    double throughput = (total_ops * 1000.0) / duration.count();
-    double latency_us = (duration.count() * 1000.0) / total_ops;
+// Adjacent-key workload: thread t only ever touches key t, so with modulo
+// indexing and the identity hash each thread owns bucket t and no data is
+// actually shared. Any slowdown versus the aligned layout comes from
+// neighbouring buckets sharing cache lines. (Fibonacci indexing would
+// scatter keys 0..7 across the table, so there'd be nothing to share.)
+template<typename HashMap>
+void runAdjacentKeyBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+    std::cout << "Threads: " << config.num_threads << " (one key each, keys 0.."
+              << (config.num_threads - 1) << ")" << std::endl;
+    std::cout << "Read ratio: " << (config.read_ratio * 100) << "%" << std::endl;
 
-    std::cout << "Duration: " << duration.count() << " ms" << std::endl;
-    std::cout << "Total operations: " << total_ops << std::endl;
-    std::cout << "Throughput: " << std::fixed << std::setprecision(2)
-              << (throughput / 1000000.0) << "M ops/sec" << std::endl;
-    std::cout << "Average latency: " << std::fixed << std::setprecision(2)
-              << latency_us << " μs" << std::endl;
+    for (int t = 0; t < config.num_threads; t++) {
+        map.put(t, 0);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, t]() {
+            std::mt19937 rng(t);
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                if (dist(rng) < config.read_ratio) {
+                    map.get(t);
+                } else {
+                    map.put(t, i);
+                }
+            }
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+}
+
+// Lookup-only workload over a fixed key set. With std::hash<int> being the
+// identity, the key pattern decides how evenly the buckets fill up.
+template<typename HashMap>
+void runKeySetBenchmark(HashMap& map, const std::string& name, const std::vector<int>& keys,
+                        const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    for (int key : keys) {
+        map.put(key, key);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &keys, &config, &total_ops, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                map.get(keys[pick(rng)]);
+            }
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+}
+
+// NUMA placement workload: the keys are loaded by a thread pinned to
+// fill_node, then every worker is pinned to run_node and mixes gets and puts
+// over them. With the two nodes different, a plain map's memory is all
+// remote to the workers.
+template<typename HashMap>
+void runNumaBenchmark(HashMap& map, const std::string& name, const std::vector<int>& keys,
+                      size_t fill_node, size_t run_node, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    std::thread filler([&map, &keys, fill_node]() {
+        NumaTopology::pin_thread_to_node(fill_node);
+        for (int key : keys) {
+            map.put(key, key);
+        }
+    });
+    filler.join();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &keys, &config, &total_ops, run_node, t]() {
+            NumaTopology::pin_thread_to_node(run_node);
+            std::mt19937 rng(t);
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                int key = keys[pick(rng)];
+                if (dist(rng) < config.read_ratio) {
+                    map.get(key);
+                } else {
+                    map.put(key, key + i);
+                }
+            }
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+}
+
+// Skewed write workload: every thread books fills against the same four
+// accounts with merge(), so writers queue up on four buckets.
+template<typename HashMap>
+void runHotKeyBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, t]() {
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                map.merge((t + i) % 4, 1L, std::plus<>());
+            }
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+    long long booked = 0;
+    for (int k = 0; k < 4; k++) {
+        booked += map.get(k).value_or(0);
+    }
+    if (booked != total_ops) {
+        std::cout << "Lost updates: " << (total_ops - booked) << std::endl;
+    }
+}
+
+// Market-maker skew: 10000 accounts, 90% of lookups go to 4 of them, and one
+// operation in 100 updates one of those 4.
+template<typename HashMap>
+void runHotReadBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    for (int i = 0; i < 10000; i++) {
+        map.put(i, i);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> percent(0, 99);
+            std::uniform_int_distribution<int> account(0, 9999);
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                int roll = percent(rng);
+                if (roll == 0) {
+                    map.put(i % 4, i);
+                } else if (roll < 90) {
+                    map.get(roll % 4);
+                } else {
+                    map.get(account(rng));
+                }
+            }
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+}
+
+// Miss-heavy workload: 10000 accounts are loaded and every lookup asks about
+// an ID that was never inserted, so each call has to prove absence.
+template<typename HashMap>
+void runMissBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    for (int i = 0; i < 10000; i++) {
+        map.put(i, i * 10);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+    std::atomic<long long> hits{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, &hits, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> key_dist(10000, 1000000);
+            long long found = 0;
+
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                found += map.contains(key_dist(rng));
+            }
+            hits += found;
+            total_ops += config.operations_per_thread;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+    if (hits != 0) {
+        std::cout << "Unexpected hits: " << hits << std::endl;
+    }
+}
+
+// Market-open workload: every thread loads fresh accounts into an empty map.
+// Reports the slowest single put() as well, since that's where a resize pause
+// would show up.
+template<typename HashMap>
+void runFillBenchmark(HashMap& map, const std::string& name, const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+    std::atomic<long long> worst_ns{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, &worst_ns, t]() {
+            long long worst = 0;
+            for (int i = 0; i < config.operations_per_thread; i++) {
+                auto before = std::chrono::steady_clock::now();
+                map.put(t * config.operations_per_thread + i, i);
+                auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - before).count();
+                worst = std::max<long long>(worst, took);
+            }
+            total_ops += config.operations_per_thread;
+            long long seen = worst_ns.load();
+            while (worst > seen && !worst_ns.compare_exchange_weak(seen, worst)) {
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
+    std::cout << "Slowest put: " << std::fixed << std::setprecision(2)
+              << (worst_ns.load() / 1000.0) << " μs" << std::endl;
+}
+
+// Mixed workload while a monitoring thread polls the map size as fast as it
+// can, the way our risk dashboard does.
+template<typename HashMap, typename Poll>
+void runMonitoredBenchmark(HashMap& map, const std::string& name, Poll poll,
+                           const BenchmarkConfig& config) {
+    std::atomic<bool> running{true};
+    std::atomic<long long> polls{0};
+    std::thread monitor([&map, &running, &polls, poll]() {
+        long long done = 0;
+        while (running) {
+            poll(map);
+            done++;
+        }
+        polls = done;
+    });
+
+    runBenchmark(map, name, config);
+    running = false;
+    monitor.join();
+    std::cout << "Size polls: " << polls << std::endl;
+}
+
+// Full-map aggregation: total exposure over every account, either with one
+// thread walking for_each_const or with parallel_reduce on the shared pool.
+template<typename HashMap>
+void runAggregationBenchmark(HashMap& map, const std::string& name, bool parallel) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    const int accounts = 200000;
+    const int passes = 20;
+    for (int i = 0; i < accounts; i++) {
+        map.put(i, (i % 1000) * 0.5);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    double checksum = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        if (parallel) {
+            checksum += map.parallel_reduce(0.0, [](const int&, const double& e) { return e; }, std::plus<>());
+        } else {
+            double total = 0;
+            map.for_each_const([&total](const int&, const double& e) { total += e; });
+            checksum += total;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start),
+                  static_cast<long long>(accounts) * passes);
+    std::cout << "Pool threads: " << (parallel ? ThreadPool::shared().thread_count() + 1 : 1)
+              << ", checksum: " << checksum << std::endl;
+}
+
+// Stand-in for a record that isn't trivially copyable, so lookups take the
+// bucket's shared lock instead of the seqlock path
+struct LimitRecord {
+    LimitRecord(int v) : value(v) {}
+    LimitRecord(const LimitRecord& other) : value(other.value) {}
+    LimitRecord& operator=(const LimitRecord& other) {
+        value = other.value;
+        return *this;
+    }
+
+    long long value;
+};
+
+// Mixed workload on LimitRecord values, which can't take the seqlock path, so
+// every read goes through the bucket lock under test.
+template<typename Lock>
+void runLockBenchmark(const std::string& name, const BenchmarkConfig& config) {
+    ConcurrentHashMap<int, LimitRecord, 1024, std::hash<int>, std::equal_to<int>, LockTraits<Lock>> map;
+    runBenchmark(map, name + " (" + std::to_string(sizeof(Lock)) + "-byte lock)", config);
+}
+
+// Limit-check workload: each thread validates batches of 1000 random accounts,
+// either with one get() per key or with a single multi_get() per batch.
+template<typename HashMap>
+void runBatchLookupBenchmark(HashMap& map, const std::string& name, bool batched,
+                             const BenchmarkConfig& config) {
+    std::cout << "\n=== " << name << " ===" << std::endl;
+
+    const int batch_size = 1000;
+    for (int i = 0; i < 10000; i++) {
+        map.put(i, i * 10);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> total_ops{0};
+
+    for (int t = 0; t < config.num_threads; t++) {
+        threads.emplace_back([&map, &config, &total_ops, batched, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> key_dist(0, 9999);
+            std::vector<int> batch(batch_size);
+
+            for (int done = 0; done < config.operations_per_thread; done += batch_size) {
+                for (auto& key : batch) {
+                    key = key_dist(rng);
+                }
+                if (batched) {
+                    map.multi_get(batch);
+                } else {
+                    for (int key : batch) {
+                        map.get(key);
+                    }
+                }
+                total_ops += batch_size;
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    reportResults(std::chrono::duration_cast<std::chrono::milliseconds>(end - start), total_ops);
 }
 
 // Correctness tests
@@ -231,10 +685,27 @@ int main() {
     ConcurrentHashMap<int, int> concurrent_map;
     runBenchmark(concurrent_map, "ConcurrentHashMap (Bucket-Level Locking)", config);
 
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, StatsTraits> stats_map;
+    runBenchmark(stats_map, "ConcurrentHashMap (CollectStats)", config);
+    MapStats observed = stats_map.stats();
+    std::cout << "Lock acquisitions: " << observed.lock_acquisitions
+              << ", contended: " << observed.contended_acquisitions
+              << ", longest chain: " << observed.max_chain_length
+              << " over " << observed.bucket_count << " buckets" << std::endl;
+
     // Benchmark 2: Baseline (global mutex)
     MutexHashMap<int, int> mutex_map;
     runBenchmark(mutex_map, "MutexHashMap (Global Mutex)", config);
 
+    LockFreeReadHashMap<int, int> lockfree_map;
+    runBenchmark(lockfree_map, "LockFreeReadHashMap (Epoch-Protected Reads)", config);
+
+    SwissHashMap<int, int> swiss_map;
+    runBenchmark(swiss_map, "SwissHashMap (SIMD Tag Groups)", config);
+
+    AtomicFlatHashMap<int, int> atomic_map;
+    runBenchmark(atomic_map, "AtomicFlatHashMap (CAS Slots, No Locks)", config);
+
     // Benchmark 3: Write-heavy workload
     std::cout << "\n--- Test 2: Write-Heavy Workload (30% reads) ---" << std::endl;
     config.read_ratio = 0.3;
@@ -245,6 +716,15 @@ int main() {
     MutexHashMap<int, int> mutex_map2;
     runBenchmark(mutex_map2, "MutexHashMap (Global Mutex)", config);
 
+    LockFreeReadHashMap<int, int> lockfree_map2;
+    runBenchmark(lockfree_map2, "LockFreeReadHashMap (Epoch-Protected Reads)", config);
+
+    SwissHashMap<int, int> swiss_map2;
+    runBenchmark(swiss_map2, "SwissHashMap (SIMD Tag Groups)", config);
+
+    AtomicFlatHashMap<int, int> atomic_map2;
+    runBenchmark(atomic_map2, "AtomicFlatHashMap (CAS Slots, No Locks)", config);
+
     // Benchmark 4: Balanced workload
     std::cout << "\n--- Test 3: Balanced Workload (50% reads) ---" << std::endl;
     config.read_ratio = 0.5;
@@ -255,6 +735,212 @@ int main() {
     MutexHashMap<int, int> mutex_map3;
     runBenchmark(mutex_map3, "MutexHashMap (Global Mutex)", config);
 
+    LockFreeReadHashMap<int, int> lockfree_map3;
+    runBenchmark(lockfree_map3, "LockFreeReadHashMap (Epoch-Protected Reads)", config);
+
+    SwissHashMap<int, int> swiss_map3;
+    runBenchmark(swiss_map3, "SwissHashMap (SIMD Tag Groups)", config);
+
+    AtomicFlatHashMap<int, int> atomic_map3;
+    runBenchmark(atomic_map3, "AtomicFlatHashMap (CAS Slots, No Locks)", config);
+
+    // Benchmark 5: False sharing between neighbouring buckets
+    std::cout << "\n--- Test 4: Adjacent Keys (50% reads) ---" << std::endl;
+
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, ModuloTraits> aligned_map;
+    runAdjacentKeyBenchmark(aligned_map, "ConcurrentHashMap (Cache-Line Aligned Buckets)", config);
+
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, PackedModuloTraits> packed_map;
+    runAdjacentKeyBenchmark(packed_map, "ConcurrentHashMap (Packed Buckets)", config);
+
+    // Benchmark 6: Bucket indexing with sequential and strided account IDs
+    std::vector<int> sequential_keys;
+    std::vector<int> strided_keys;
+    for (int i = 0; i < 10000; i++) {
+        sequential_keys.push_back(i);
+        strided_keys.push_back(i * 1024);
+    }
+
+    std::cout << "\n--- Test 5: Sequential Keys (lookups only) ---" << std::endl;
+    ConcurrentHashMap<int, int> fib_seq_map;
+    runKeySetBenchmark(fib_seq_map, "ConcurrentHashMap (Fibonacci Mask)", sequential_keys, config);
+
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, ModuloTraits> mod_seq_map;
+    runKeySetBenchmark(mod_seq_map, "ConcurrentHashMap (Modulo)", sequential_keys, config);
+
+    std::cout << "\n--- Test 6: Keys Strided by 1024 (lookups only) ---" << std::endl;
+    ConcurrentHashMap<int, int> fib_stride_map;
+    runKeySetBenchmark(fib_stride_map, "ConcurrentHashMap (Fibonacci Mask)", strided_keys, config);
+
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, ModuloTraits> mod_stride_map;
+    runKeySetBenchmark(mod_stride_map, "ConcurrentHashMap (Modulo)", strided_keys, config);
+
+    // Benchmark 7: Batched lookups
+    std::cout << "\n--- Test 7: Batches of 1000 Lookups ---" << std::endl;
+    ConcurrentHashMap<int, int> loop_map;
+    runBatchLookupBenchmark(loop_map, "ConcurrentHashMap (get() per key)", false, config);
+
+    ConcurrentHashMap<int, int> batch_map;
+    runBatchLookupBenchmark(batch_map, "ConcurrentHashMap (multi_get per batch)", true, config);
+
+    ConcurrentHashMap<int, LimitRecord> locked_loop_map;
+    runBatchLookupBenchmark(locked_loop_map, "ConcurrentHashMap<int, LimitRecord> (get() per key)", false, config);
+
+    ConcurrentHashMap<int, LimitRecord> locked_batch_map;
+    runBatchLookupBenchmark(locked_batch_map, "ConcurrentHashMap<int, LimitRecord> (multi_get per batch)", true, config);
+
+    // Benchmark 8: Lookups that miss
+    std::cout << "\n--- Test 8: contains() on Absent Keys ---" << std::endl;
+    ConcurrentHashMap<int, int> chained_miss_map;
+    runMissBenchmark(chained_miss_map, "ConcurrentHashMap (Bucket Chains)", config);
+
+    SwissHashMap<int, int> swiss_miss_map;
+    runMissBenchmark(swiss_miss_map, "SwissHashMap (SIMD Tag Groups)", config);
+
+    // Benchmark 9: Filling an empty map
+    std::cout << "\n--- Test 9: Market Open Fill (puts of new keys) ---" << std::endl;
+    ConcurrentHashMap<int, int> resizing_fill_map;
+    runFillBenchmark(resizing_fill_map, "ConcurrentHashMap (Online Resize)", config);
+
+    ConcurrentHashMap<int, int, 1024, std::hash<int>, std::equal_to<int>, SegmentedTraits> segmented_fill_map;
+    runFillBenchmark(segmented_fill_map, "ConcurrentHashMap (Segmented Buckets)", config);
+
+    AtomicFlatHashMap<int, int> atomic_fill_map;
+    runFillBenchmark(atomic_fill_map, "AtomicFlatHashMap (Stop-the-Writers Resize)", config);
+
+    // Benchmark 10: Allocator churn
+    std::cout << "\n--- Test 10: Churn (30% reads), std::allocator vs PoolAllocator ---" << std::endl;
+    config.read_ratio = 0.3;
+    using PooledEntry = PoolAllocator<std::pair<const int, int>>;
+
+    LockFreeReadHashMap<int, int> std_node_map;
+    runBenchmark(std_node_map, "LockFreeReadHashMap (std::allocator)", config);
+
+    LockFreeReadHashMap<int, int, 1024, PooledEntry> pooled_node_map;
+    runBenchmark(pooled_node_map, "LockFreeReadHashMap (PoolAllocator)", config);
+
+    ConcurrentHashMap<int, int, 64, std::hash<int>, std::equal_to<int>, SegmentedTraits> std_overflow_map;
+    runBenchmark(std_overflow_map, "ConcurrentHashMap, 64 Segmented Buckets (std::allocator)", config);
+
+    ConcurrentHashMap<int, int, 64, std::hash<int>, std::equal_to<int>, SegmentedTraits, PooledEntry> pooled_overflow_map;
+    runBenchmark(pooled_overflow_map, "ConcurrentHashMap, 64 Segmented Buckets (PoolAllocator)", config);
+
+    // Benchmark 11: Size polling
+    std::cout << "\n--- Test 11: Writers (50% reads) with a Thread Polling the Size ---" << std::endl;
+    config.read_ratio = 0.5;
+
+    ConcurrentHashMap<int, int> exact_size_map;
+    runMonitoredBenchmark(exact_size_map, "ConcurrentHashMap (polling size())",
+                          [](auto& map) { return map.size(); }, config);
+
+    ConcurrentHashMap<int, int> approx_size_map;
+    runMonitoredBenchmark(approx_size_map, "ConcurrentHashMap (polling approximate_size())",
+                          [](auto& map) { return map.approximate_size(); }, config);
+
+    // Benchmark 12: Full-map aggregation
+    std::cout << "\n--- Test 12: Total Exposure over 200K Accounts ---" << std::endl;
+    ConcurrentHashMap<int, double> serial_exposure_map;
+    runAggregationBenchmark(serial_exposure_map, "ConcurrentHashMap (for_each_const)", false);
+
+    ConcurrentHashMap<int, double> parallel_exposure_map;
+    runAggregationBenchmark(parallel_exposure_map, "ConcurrentHashMap (parallel_reduce)", true);
+
+    // Benchmark 13: Bucket lock types
+    for (double ratio : {0.9, 0.5, 0.1}) {
+        std::cout << "\n--- Test 13: Bucket Locks, " << static_cast<int>(ratio * 100)
+                  << "% Reads ---" << std::endl;
+        config.read_ratio = ratio;
+        runLockBenchmark<std::shared_mutex>("std::shared_mutex", config);
+        runLockBenchmark<SpinRWLock>("SpinRWLock", config);
+        runLockBenchmark<TicketLock>("TicketLock", config);
+        runLockBenchmark<FutexRWLock>("FutexRWLock", config);
+    }
+
+    // Benchmark 14: Word-sized positions
+    std::cout << "\n--- Test 14: Account Positions, int64_t -> double (70% reads) ---" << std::endl;
+    config.read_ratio = 0.7;
+
+    ConcurrentHashMap<int64_t, double> locked_positions;
+    runBenchmark(locked_positions, "ConcurrentHashMap<int64_t, double>", config);
+
+    AtomicFlatHashMap<int64_t, double> atomic_positions;
+    runBenchmark(atomic_positions, "AtomicFlatHashMap<int64_t, double>", config);
+
+    // Benchmark 15: Reference data
+    std::cout << "\n--- Test 15: Reference Data (99% reads) ---" << std::endl;
+    config.read_ratio = 0.99;
+
+    ConcurrentHashMap<int, int> reference_map;
+    runBenchmark(reference_map, "ConcurrentHashMap (Bucket-Level Locking)", config);
+
+    LockFreeReadHashMap<int, int> lockfree_reference_map;
+    runBenchmark(lockfree_reference_map, "LockFreeReadHashMap (Epoch-Protected Reads)", config);
+
+    SnapshotHashMap<int, int> snapshot_reference_map;
+    runBenchmark(snapshot_reference_map, "SnapshotHashMap (Immutable Versions)", config);
+
+    // Benchmark 16: NUMA placement
+    std::cout << "\n--- Test 16: NUMA Local vs Remote Memory (90% reads) ---" << std::endl;
+    config.read_ratio = 0.9;
+    size_t numa_nodes = NumaTopology::node_count();
+    size_t far_node = numa_nodes - 1;
+    std::cout << "NUMA nodes: " << numa_nodes << std::endl;
+    if (numa_nodes == 1) {
+        std::cout << "(single node: \"remote\" runs use the same memory as local ones)" << std::endl;
+    }
+
+    std::vector<int> node0_keys;
+    std::vector<int> far_keys;
+    std::vector<int> all_keys;
+    NumaShardedHashMap<int, int> partitioned_map;
+    for (int i = 0; i < 100000; i++) {
+        all_keys.push_back(i);
+        if (partitioned_map.home_node(i) == 0) {
+            node0_keys.push_back(i);
+        }
+        if (partitioned_map.home_node(i) == far_node) {
+            far_keys.push_back(i);
+        }
+    }
+
+    ConcurrentHashMap<int, int> local_plain_map;
+    runNumaBenchmark(local_plain_map, "ConcurrentHashMap, filled and used on node 0",
+                     all_keys, 0, 0, config);
+
+    ConcurrentHashMap<int, int> remote_plain_map;
+    runNumaBenchmark(remote_plain_map, "ConcurrentHashMap, filled on node " + std::to_string(far_node) +
+                     ", used on node 0", all_keys, far_node, 0, config);
+
+    runNumaBenchmark(partitioned_map, "NumaShardedHashMap (Partitioned), node 0 keys from node 0",
+                     node0_keys, far_node, 0, config);
+
+    NumaShardedHashMap<int, int> partitioned_remote_map;
+    runNumaBenchmark(partitioned_remote_map, "NumaShardedHashMap (Partitioned), node " +
+                     std::to_string(far_node) + " keys from node 0", far_keys, 0, 0, config);
+
+    NumaShardedHashMap<int, int> replicated_map(NumaMode::Replicated);
+    runNumaBenchmark(replicated_map, "NumaShardedHashMap (Replicated), all keys from node 0",
+                     all_keys, far_node, 0, config);
+
+    // Benchmark 17: Hot-key writes
+    std::cout << "\n--- Test 17: merge() on 4 Hot Accounts ---" << std::endl;
+    ConcurrentHashMap<int, long> locked_hot_map;
+    runHotKeyBenchmark(locked_hot_map, "ConcurrentHashMap (Lock per Write)", config);
+
+    ConcurrentHashMap<int, long, 1024, std::hash<int>, std::equal_to<int>, CombiningTraits> combining_hot_map;
+    runHotKeyBenchmark(combining_hot_map, "ConcurrentHashMap (FlatCombining)", config);
+
+    // Benchmark 18: Reads concentrated on a few hot keys
+    std::cout << "\n--- Test 18: 90% of Reads on 4 Hot Accounts ---" << std::endl;
+    ConcurrentHashMap<int, LimitRecord> shared_hot_read_map;
+    runHotReadBenchmark(shared_hot_read_map, "ConcurrentHashMap<int, LimitRecord> (Bucket Read Lock)", config);
+
+    ConcurrentHashMap<int, LimitRecord, 1024, std::hash<int>, std::equal_to<int>, HotKeyTraits> replica_hot_read_map;
+    runHotReadBenchmark(replica_hot_read_map, "ConcurrentHashMap<int, LimitRecord> (HotKeyReplicas)", config);
+    if (replica_hot_read_map.hot_keys().size() != 4) {
+        std::cout << "Hot keys detected: " << replica_hot_read_map.hot_keys().size() << std::endl;
+    }
+
     std::cout << "\n========================================" << std::endl;
     std::cout << "  Benchmarks Complete!" << std::endl;
     std::cout << "========================================" << std::endl;
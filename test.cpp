@@ -1,8 +1,87 @@
+#include "include/atomic_flat_hashmap.hpp"
 #include "include/concurrent_hashmap.hpp"
+#include "include/lockfree_read_hashmap.hpp"
+#include "include/numa_hashmap.hpp"
+#include "include/pool_allocator.hpp"
+#include "include/snapshot_hashmap.hpp"
+#include "include/swiss_hashmap.hpp"
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 using namespace std;
 
+struct SegmentedTraits : DefaultMapTraits {
+    static constexpr bool SegmentedBuckets = true;
+};
+
+struct StatsTraits : DefaultMapTraits {
+    static constexpr bool CollectStats = true;
+};
+
+struct CombiningTraits : DefaultMapTraits {
+    static constexpr bool FlatCombining = true;
+};
+
+struct SpinCombiningTraits : CombiningTraits {
+    using BucketLock = SpinRWLock;
+};
+
+struct HotKeyTraits : DefaultMapTraits {
+    static constexpr bool HotKeyReplicas = true;
+};
+
+// Counts live instances, so a test can tell whether retired snapshot
+// versions were actually freed.
+struct DeskLimit {
+    static inline atomic<long> live{0};
+
+    DeskLimit(int l = 0) : limit(l) { ++live; }
+    DeskLimit(const DeskLimit& other) : limit(other.limit) { ++live; }
+    DeskLimit& operator=(const DeskLimit&) = default;
+    ~DeskLimit() { --live; }
+
+    int limit;
+};
+
+template<typename Lock>
+struct LockTraits : DefaultMapTraits {
+    using BucketLock = Lock;
+};
+
+// Four threads append to and read back 8 shared books; the totals only add
+// up if Lock excludes writers from each other and from readers.
+template<typename Lock>
+bool booksBalance() {
+    ConcurrentHashMap<int, string, 4, hash<int>, equal_to<int>, LockTraits<Lock>> books;
+    vector<thread> clerks;
+    atomic<bool> torn{false};
+    for (int t = 0; t < 4; t++) {
+        clerks.emplace_back([&books, &torn]() {
+            for (int i = 0; i < 5000; i++) {
+                books.merge(i % 8, string("x"), [](const string& a, const string& b) { return a + b; });
+                auto book = books.get(i % 8);
+                if (!book || book->find_first_not_of('x') != string::npos) {
+                    torn = true;
+                }
+            }
+        });
+    }
+    for (auto& c : clerks) {
+        c.join();
+    }
+    size_t total = 0;
+    books.for_each_const([&total](const int&, const string& book) {
+        total += book.size();
+    });
+    return !torn && total == 20000;
+}
+
 int main() {
     cout << "Testing ConcurrentHashMap...\n\n";
 
@@ -52,6 +131,817 @@ int main() {
     cout << "Test 5: Check size\n";
     cout << "Current size: " << map.size() << " ✓\n\n";
 
+    // Test 6: Bucket overflow
+    cout << "Test 6: Spilling past the inline slots\n";
+    ConcurrentHashMap<int, int, 1> one_bucket;
+    for (int i = 0; i < 20; i++) {
+        one_bucket.put(i, i * 10);
+    }
+    for (int i = 0; i < 20; i += 3) {
+        one_bucket.remove(i);
+    }
+    bool overflow_ok = one_bucket.size() == 13;
+    for (int i = 0; i < 20; i++) {
+        auto v = one_bucket.get(i);
+        overflow_ok = overflow_ok && (i % 3 == 0 ? !v : (v && *v == i * 10));
+    }
+    if (overflow_ok) {
+        cout << "20 keys in one bucket, 7 removed ✓\n\n";
+    }
+
+    // Test 7: Online resize
+    cout << "Test 7: Growing past the initial bucket count\n";
+    ConcurrentHashMap<int, int, 16> growing;
+    vector<thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&growing, t]() {
+            for (int i = 0; i < 5000; i++) {
+                growing.put(t * 5000 + i, i);
+            }
+        });
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+    bool resize_ok = growing.size() == 20000 && growing.bucket_count() > 16;
+    for (int key = 0; key < 20000; key++) {
+        auto v = growing.get(key);
+        resize_ok = resize_ok && v && *v == key % 5000;
+    }
+    // A non-power-of-two count can't use the Fibonacci mask and keeps the modulo.
+    ConcurrentHashMap<int, int, 1000> decimal;
+    for (int key = 0; key < 3000; key++) {
+        decimal.put(key, key);
+    }
+    resize_ok = resize_ok && decimal.size() == 3000 && decimal.bucket_count() > 1000;
+    for (int key = 0; key < 3000; key++) {
+        resize_ok = resize_ok && decimal.get(key) == key;
+    }
+    if (resize_ok) {
+        cout << "20000 keys, " << growing.bucket_count() << " buckets; 3000 keys from 1000 buckets ✓\n\n";
+    }
+
+    // Test 8: Optimistic reads never see a torn value
+    cout << "Test 8: Seqlock reads under concurrent writes\n";
+    struct Position {
+        long long quantity;
+        long long check;
+    };
+    ConcurrentHashMap<int, Position, 4> positions;
+    positions.put(7, {0, 0});
+    atomic<bool> done{false};
+    atomic<bool> torn{false};
+    thread updater([&]() {
+        for (long long i = 1; i <= 200000; i++) {
+            positions.put(7, {i, i});
+        }
+        done = true;
+    });
+    vector<thread> readers;
+    for (int t = 0; t < 3; t++) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                auto p = positions.get(7);
+                if (!p || p->quantity != p->check) {
+                    torn = true;
+                }
+            }
+        });
+    }
+    updater.join();
+    for (auto& r : readers) {
+        r.join();
+    }
+    if (!torn) {
+        cout << "No torn reads across 200000 updates ✓\n\n";
+    }
+
+    // Test 9: Lock-free reads with epoch reclamation
+    cout << "Test 9: LockFreeReadHashMap under concurrent replace/remove\n";
+    LockFreeReadHashMap<int, string, 8> lockfree;
+    atomic<bool> writing{true};
+    atomic<bool> bad_read{false};
+    thread churn([&]() {
+        for (int i = 0; i < 50000; i++) {
+            int key = i % 32;
+            if (i % 5 == 0) {
+                lockfree.remove(key);
+            } else {
+                lockfree.put(key, "value-" + to_string(key));
+            }
+        }
+        writing = false;
+    });
+    vector<thread> lookups;
+    for (int t = 0; t < 3; t++) {
+        lookups.emplace_back([&]() {
+            while (writing) {
+                for (int key = 0; key < 32; key++) {
+                    auto v = lockfree.get(key);
+                    if (v && *v != "value-" + to_string(key)) {
+                        bad_read = true;
+                    }
+                }
+            }
+        });
+    }
+    churn.join();
+    for (auto& l : lookups) {
+        l.join();
+    }
+    if (!bad_read && lockfree.size() <= 32) {
+        cout << "50000 writes raced with lock-free readers ✓\n\n";
+    }
+
+    // Test 10: Heterogeneous lookup
+    cout << "Test 10: Looking up string keys by string_view\n";
+    ConcurrentHashMap<string, int> accounts;
+    accounts.put("ACC-1001", 500);
+    accounts.put("ACC-1002", 750);
+    const char* message = "LIMIT ACC-1002 CHECK";
+    string_view account_id(message + 6, 8);
+    auto limit = accounts.get(account_id);
+    bool hetero_ok = limit && *limit == 750 && accounts.contains("ACC-1001") &&
+                     accounts.remove(account_id) && !accounts.contains(account_id);
+    if (hetero_ok) {
+        cout << "Found, checked and removed via string_view ✓\n\n";
+    }
+
+    // Test 11: Zero-copy visit
+    cout << "Test 11: Reading a value in place with visit()\n";
+    size_t name_length = 0;
+    bool visited = map.visit(1, [&](const string& name) { name_length = name.size(); });
+    bool missing_visited = map.visit(2, [&](const string&) { name_length = 0; });
+    if (visited && !missing_visited && name_length == string("Alice Updated").size()) {
+        cout << "Visited key 1 without copying (" << name_length << " chars) ✓\n\n";
+    }
+
+    // Test 12: Move-aware insertion
+    cout << "Test 12: emplace, try_emplace and insert_or_assign\n";
+    ConcurrentHashMap<int, string> names;
+    bool first = names.insert_or_assign(10, string("Dave"));
+    bool second = names.insert_or_assign(10, "David");
+    bool placed = names.try_emplace(11, 3, 'x');
+    bool kept = !names.try_emplace(11, "ignored");
+    bool emplaced = names.emplace(12, "Erin") && !names.emplace(12, "Eve");
+    string frank = "Frank";
+    names.put(13, std::move(frank));
+    if (first && !second && *names.get(10) == "David" && placed && kept &&
+        *names.get(11) == "xxx" && emplaced && *names.get(12) == "Erin" &&
+        *names.get(13) == "Frank") {
+        cout << "All four insertion paths behave ✓\n\n";
+    }
+
+    // Test 13: Atomic read-modify-write
+    cout << "Test 13: merge and compute under concurrent fills\n";
+    ConcurrentHashMap<int, double> net_positions;
+    vector<thread> traders;
+    for (int t = 0; t < 4; t++) {
+        traders.emplace_back([&net_positions]() {
+            for (int i = 0; i < 10000; i++) {
+                net_positions.merge(i % 10, 1.0, plus<>());
+            }
+        });
+    }
+    for (auto& trader : traders) {
+        trader.join();
+    }
+    bool merged = true;
+    for (int account = 0; account < 10; account++) {
+        merged = merged && *net_positions.get(account) == 4000.0;
+    }
+    net_positions.compute_if_present(0, [](double& qty) { qty = -qty; });
+    bool absent_added = net_positions.compute_if_absent(42, []() { return 7.5; }) &&
+                        !net_positions.compute_if_absent(42, []() { return 0.0; });
+    auto flattened = net_positions.compute(1, [](const double*) { return optional<double>(); });
+    // The result is moved into the map; the caller still gets a copy back.
+    ConcurrentHashMap<int, string> desk_notes;
+    auto note = desk_notes.compute(3, [](const string* current) -> optional<string> {
+        return (current ? *current : string("opened")) + " by desk 3";
+    });
+    auto appended = desk_notes.compute(3, [](const string* current) -> optional<string> {
+        return *current + ", amended";
+    });
+    bool noted = note == "opened by desk 3" && appended == "opened by desk 3, amended" &&
+                 desk_notes.get(3) == appended;
+    if (merged && *net_positions.get(0) == -4000.0 && absent_added && noted &&
+        *net_positions.get(42) == 7.5 && !flattened && !net_positions.contains(1)) {
+        cout << "40000 concurrent merges summed exactly ✓\n\n";
+    }
+
+    // Test 14: Batched lookup
+    cout << "Test 14: multi_get over a batch of accounts\n";
+    vector<int> batch = {1, 5, 3, 42, 0, 9, 1000};
+    auto limits = net_positions.multi_get(batch);
+    bool batch_ok = limits.size() == batch.size();
+    for (size_t i = 0; i < batch.size() && batch_ok; i++) {
+        auto single = net_positions.get(batch[i]);
+        batch_ok = limits[i].has_value() == single.has_value() && (!single || *limits[i] == *single);
+    }
+    // String values skip the seqlock, and a batch this size against a small
+    // table takes the sorted, one-lock-per-bucket path. Odd keys are absent.
+    ConcurrentHashMap<int, string, 16> account_names;
+    for (int key = 0; key < 400; key += 2) {
+        account_names.put(key, "acct" + to_string(key));
+    }
+    vector<int> dense_batch;
+    for (int i = 0; i < 800; i++) {
+        dense_batch.push_back((i * 37) % 400);
+    }
+    auto looked_up = account_names.multi_get(dense_batch);
+    batch_ok = batch_ok && looked_up.size() == dense_batch.size();
+    for (size_t i = 0; i < dense_batch.size() && batch_ok; i++) {
+        int key = dense_batch[i];
+        batch_ok = key % 2 == 0 ? looked_up[i] == "acct" + to_string(key) : !looked_up[i];
+    }
+    if (batch_ok) {
+        cout << "7 keys match get(); 800 keys sorted by bucket, 400 absent ✓\n\n";
+    }
+
+    // Test 15: Batched writes
+    cout << "Test 15: multi_put and atomic apply_deltas\n";
+    ConcurrentHashMap<int, long long, 64> book;
+    vector<pair<int, long long>> opening;
+    for (int account = 0; account < 100; account++) {
+        opening.push_back({account, 1000});
+    }
+    book.multi_put(opening);
+    vector<thread> settlers;
+    for (int t = 0; t < 4; t++) {
+        settlers.emplace_back([&book, t]() {
+            vector<pair<int, long long>> transfers;
+            for (int i = 0; i < 50; i++) {
+                int from = (i * 7 + t) % 100;
+                int to = (i * 13 + t * 31) % 100;
+                transfers.push_back({from, -5});
+                transfers.push_back({to, 5});
+            }
+            // Yielding mid-batch gives the auditor every chance to look at a
+            // half-applied transfer, if the locks would let it.
+            auto book_transfer = [](long long current, long long delta) {
+                this_thread::yield();
+                return current + delta;
+            };
+            for (int round = 0; round < 200; round++) {
+                book.apply_deltas(transfers, book_transfer, BatchMode::Atomic);
+            }
+        });
+    }
+    // The auditor reads every account inside one atomic batch of zero deltas,
+    // which holds all their locks at once. It would see the total drift if a
+    // transfer were ever visible half-applied.
+    atomic<bool> settling{true};
+    atomic<int> audits{0};
+    atomic<int> torn_audits{0};
+    thread auditor([&book, &settling, &audits, &torn_audits]() {
+        vector<pair<int, long long>> audit;
+        for (int account = 0; account < 100; account++) {
+            audit.push_back({account, 0});
+        }
+        do {
+            long long seen = 0;
+            book.apply_deltas(audit, [&seen](long long current, long long) {
+                seen += current;
+                return current;
+            }, BatchMode::Atomic);
+            ++audits;
+            if (seen != 100000) {
+                ++torn_audits;
+            }
+        } while (settling.load());
+    });
+    for (auto& s : settlers) {
+        s.join();
+    }
+    settling = false;
+    auditor.join();
+    long long book_total = 0;
+    for (int account = 0; account < 100; account++) {
+        book_total += *book.get(account);
+    }
+    if (book.size() == 100 && book_total == 100000 && torn_audits == 0) {
+        cout << "800 atomic transfer batches, " << audits << " audits all saw 100000 ✓\n\n";
+    }
+
+    // Test 16: Open-addressing engine
+    cout << "Test 16: SwissHashMap grows, erases and reuses slots\n";
+    SwissHashMap<string, int, 4> symbols;
+    vector<thread> listers;
+    for (int t = 0; t < 4; t++) {
+        listers.emplace_back([&symbols, t]() {
+            for (int i = 0; i < 5000; i++) {
+                symbols.put("SYM" + to_string(t * 5000 + i), i);
+            }
+            // Drop every other symbol so later probes have to step over tombstones
+            for (int i = 0; i < 5000; i += 2) {
+                symbols.remove("SYM" + to_string(t * 5000 + i));
+            }
+        });
+    }
+    for (auto& l : listers) {
+        l.join();
+    }
+    bool symbols_ok = symbols.size() == 10000;
+    for (int id = 0; id < 20000; id++) {
+        auto listed = symbols.get(string_view("SYM" + to_string(id)));
+        symbols_ok = symbols_ok && (id % 2 == 1 ? listed == (id % 5000) : !listed);
+    }
+    for (int id = 0; id < 20000; id += 2) {
+        symbols.put("SYM" + to_string(id), -1);
+    }
+    symbols_ok = symbols_ok && symbols.size() == 20000 && symbols.get("SYM0") == -1 &&
+                 !symbols.contains("SYM20000") && symbols.remove(string_view("SYM19999")) &&
+                 !symbols.contains("SYM19999") && symbols.size() == 19999;
+    symbols.clear();
+    if (symbols_ok && symbols.size() == 0 && !symbols.contains("SYM1")) {
+        cout << "20000 symbols listed, half delisted and relisted ✓\n\n";
+    }
+
+    // Test 17: Segmented buckets
+    cout << "Test 17: SegmentedBuckets grows buckets, never the table\n";
+    ConcurrentHashMap<string, int, 4, DefaultHash<string>, DefaultKeyEqual<string>, SegmentedTraits> orders;
+    vector<thread> routers;
+    for (int t = 0; t < 4; t++) {
+        routers.emplace_back([&orders, t]() {
+            for (int i = 0; i < 5000; i++) {
+                orders.put("ORD" + to_string(t * 5000 + i), i);
+            }
+            for (int i = 0; i < 5000; i += 3) {
+                orders.remove("ORD" + to_string(t * 5000 + i));
+            }
+        });
+    }
+    for (auto& r : routers) {
+        r.join();
+    }
+    bool orders_ok = orders.bucket_count() == 4;
+    size_t open_orders = 0;
+    for (int id = 0; id < 20000; id++) {
+        bool cancelled = (id % 5000) % 3 == 0;
+        auto order = orders.get(string_view("ORD" + to_string(id)));
+        orders_ok = orders_ok && (cancelled ? !order : order == id % 5000);
+        open_orders += !cancelled;
+    }
+    if (orders_ok && orders.size() == open_orders) {
+        cout << open_orders << " open orders across 4 buckets ✓\n\n";
+    }
+
+    // Test 18: Pool allocator
+    cout << "Test 18: maps on PoolAllocator under churn\n";
+    LockFreeReadHashMap<int, string, 64, PoolAllocator<pair<const int, string>>> quotes;
+    ConcurrentHashMap<int, string, 1, hash<int>, equal_to<int>, DefaultMapTraits,
+                      PoolAllocator<pair<const int, string>>> spilled;
+    vector<thread> quoters;
+    for (int t = 0; t < 4; t++) {
+        quoters.emplace_back([&quotes, &spilled, t]() {
+            for (int round = 0; round < 20; round++) {
+                for (int i = 0; i < 100; i++) {
+                    int id = t * 100 + i;
+                    quotes.put(id, "QUOTE-" + to_string(round));
+                    spilled.put(id, "QUOTE-" + to_string(round));
+                }
+                for (int i = 0; i < 100; i += 2) {
+                    quotes.remove(t * 100 + i);
+                    spilled.remove(t * 100 + i);
+                }
+            }
+        });
+    }
+    for (auto& q : quoters) {
+        q.join();
+    }
+    bool quotes_ok = quotes.size() == 200 && spilled.size() == 200;
+    for (int id = 0; id < 400; id++) {
+        auto expected = id % 2 == 1 ? optional<string>("QUOTE-19") : nullopt;
+        quotes_ok = quotes_ok && quotes.get(id) == expected && spilled.get(id) == expected;
+    }
+    // Cache-line aligned blocks (bucket arrays) are pooled too, still aligned.
+    struct alignas(64) CacheLine {
+        char bytes[64];
+    };
+    PoolAllocator<CacheLine> line_pool;
+    vector<CacheLine*> lines;
+    for (size_t n = 1; n <= 5; n++) {
+        lines.push_back(line_pool.allocate(n));
+        quotes_ok = quotes_ok && reinterpret_cast<uintptr_t>(lines.back()) % 64 == 0;
+    }
+    for (size_t n = 1; n <= 5; n++) {
+        line_pool.deallocate(lines[n - 1], n);
+    }
+    if (quotes_ok) {
+        cout << "Pooled nodes, overflow blocks and aligned blocks recycled correctly ✓\n\n";
+    }
+
+    // Test 19: Striped size counter
+    cout << "Test 19: size() and approximate_size() while writers run\n";
+    ConcurrentHashMap<int, int, 16> fills;
+    atomic<bool> filling{true};
+    atomic<bool> size_sane{true};
+    thread monitor([&fills, &filling, &size_sane]() {
+        while (filling) {
+            size_t approx = fills.approximate_size();
+            size_t exact = fills.size();
+            if (approx > 40000 || exact > 40000) {
+                size_sane = false;
+            }
+        }
+    });
+    vector<thread> fillers;
+    for (int t = 0; t < 4; t++) {
+        fillers.emplace_back([&fills, t]() {
+            for (int i = 0; i < 10000; i++) {
+                fills.put(t * 10000 + i, i);
+            }
+            for (int i = 0; i < 10000; i += 4) {
+                fills.remove(t * 10000 + i);
+            }
+        });
+    }
+    for (auto& f : fillers) {
+        f.join();
+    }
+    filling = false;
+    monitor.join();
+    if (size_sane && fills.size() == 30000 && fills.approximate_size() == 30000 &&
+        fills.bucket_count() >= 16384) {
+        cout << "Counts agree at 30000 after concurrent fills ✓\n\n";
+    }
+
+    // Test 20: Iteration
+    cout << "Test 20: for_each and range-split traversal during a resize\n";
+    ConcurrentHashMap<int, long long, 8> eod_positions;
+    for (int account = 0; account < 1000; account++) {
+        eod_positions.put(account, account);
+    }
+    eod_positions.for_each([](const int&, long long& qty) {
+        qty *= 2;
+    });
+    atomic<bool> trading{true};
+    thread late_trader([&eod_positions, &trading]() {
+        for (int account = 1000; trading || account < 20000; account++) {
+            eod_positions.put(account, 0);
+        }
+    });
+    vector<long long> dumped(3, 0);
+    vector<int> dumped_accounts(3, 0);
+    vector<thread> dumpers;
+    size_t per_dumper = (eod_positions.range_count() + 2) / 3;
+    for (int d = 0; d < 3; d++) {
+        dumpers.emplace_back([&, d]() {
+            eod_positions.for_each_const_range(d * per_dumper, (d + 1) * per_dumper,
+                                               [&](const int& account, const long long& qty) {
+                if (account < 1000) {
+                    dumped[d] += qty;
+                    dumped_accounts[d]++;
+                }
+            });
+        });
+    }
+    for (auto& d : dumpers) {
+        d.join();
+    }
+    trading = false;
+    late_trader.join();
+    long long dump_total = dumped[0] + dumped[1] + dumped[2];
+    int dump_accounts = dumped_accounts[0] + dumped_accounts[1] + dumped_accounts[2];
+    size_t eod_entries = 0;
+    eod_positions.for_each_const([&eod_entries](const int&, const long long&) {
+        eod_entries++;
+    });
+    if (dump_accounts == 1000 && dump_total == 999000 && eod_entries == eod_positions.size()) {
+        cout << "3 dumpers saw each of 1000 accounts once ✓\n\n";
+    }
+
+    // Test 21: Parallel traversal
+    cout << "Test 21: parallel_reduce and parallel_for_each on a pool\n";
+    ThreadPool risk_pool(3);
+    ConcurrentHashMap<int, double, 64> exposures;
+    for (int account = 0; account < 50000; account++) {
+        exposures.put(account, account % 100);
+    }
+    double total_exposure = exposures.parallel_reduce(
+        0.0, [](const int&, const double& e) { return e; }, plus<>(), risk_pool);
+    atomic<int> over_limit{0};
+    exposures.parallel_for_each([&over_limit](const int&, const double& e) {
+        if (e >= 90) {
+            over_limit++;
+        }
+    }, risk_pool);
+    atomic<bool> nested_ok{true};
+    risk_pool.parallel_for(4, [&](size_t) {
+        if (exposures.parallel_reduce(size_t(0), [](const int&, const double&) { return size_t(1); },
+                                      plus<>(), risk_pool) != 50000) {
+            nested_ok = false;
+        }
+    });
+    if (total_exposure == 2475000.0 && over_limit == 5000 && nested_ok) {
+        cout << "Exposure 2475000 summed across 3 workers ✓\n\n";
+    }
+
+    // Test 22: Statistics
+    cout << "Test 22: stats() counts operations, locks and chain lengths\n";
+    ConcurrentHashMap<int, string, 64, hash<int>, equal_to<int>, StatsTraits> watched;
+    vector<thread> watchers;
+    for (int t = 0; t < 4; t++) {
+        watchers.emplace_back([&watched, t]() {
+            for (int i = 0; i < 1000; i++) {
+                watched.put(t * 1000 + i, "ACC");
+                watched.get(i);
+            }
+            watched.remove(t * 1000);
+        });
+    }
+    for (auto& w : watchers) {
+        w.join();
+    }
+    MapStats watched_stats = watched.stats();
+    size_t histogram_entries = 0;
+    for (size_t length = 0; length < watched_stats.chain_length_histogram.size(); length++) {
+        histogram_entries += length * watched_stats.chain_length_histogram[length];
+    }
+    uint64_t waits = 0;
+    for (uint64_t w : watched_stats.lock_wait_histogram) {
+        waits += w;
+    }
+    if (watched_stats.operation_count(StatOp::Insert) == 4000 &&
+        watched_stats.operation_count(StatOp::Get) == 4000 &&
+        watched_stats.operation_count(StatOp::Remove) == 4 &&
+        watched_stats.lock_acquisitions >= 8004 &&
+        waits == watched_stats.contended_acquisitions &&
+        watched_stats.bucket_count == watched.bucket_count() &&
+        histogram_entries == 3996 && watched_stats.max_chain_length >= 1) {
+        cout << watched_stats.lock_acquisitions << " lock acquisitions, "
+             << watched_stats.contended_acquisitions << " contended, longest chain "
+             << watched_stats.max_chain_length << " ✓\n\n";
+    }
+
+    // Test 23: Bucket lock policies
+    cout << "Test 23: every BucketLock keeps buckets consistent\n";
+    if (booksBalance<shared_mutex>() && booksBalance<SpinRWLock>() &&
+        booksBalance<TicketLock>() && booksBalance<FutexRWLock>()) {
+        cout << "shared_mutex, SpinRWLock, TicketLock and FutexRWLock all balance ✓\n\n";
+    }
+
+    // Test 24: Word-sized keys and values without locks
+    cout << "Test 24: AtomicFlatHashMap grows and stays exact under concurrent writers\n";
+    AtomicFlatHashMap<int64_t, double> net_exposure(16);
+    atomic<bool> reads_consistent{true};
+    vector<thread> desks;
+    for (int t = 0; t < 4; t++) {
+        desks.emplace_back([&net_exposure, &reads_consistent, t]() {
+            for (int64_t i = 0; i < 5000; i++) {
+                int64_t account = t * 100000 + i;
+                net_exposure.put(account, account * 0.5);
+                auto seen = net_exposure.get(account);
+                if (!seen || *seen != account * 0.5) {
+                    reads_consistent = false;
+                }
+            }
+            for (int64_t i = 0; i < 5000; i += 2) {
+                net_exposure.remove(t * 100000 + i);
+            }
+        });
+    }
+    for (auto& desk : desks) {
+        desk.join();
+    }
+    bool exposure_ok = reads_consistent && net_exposure.size() == 10000;
+    for (int t = 0; t < 4 && exposure_ok; t++) {
+        for (int64_t i = 0; i < 5000; i++) {
+            auto seen = net_exposure.get(t * 100000 + i);
+            exposure_ok = exposure_ok && (i % 2 == 0 ? !seen : seen && *seen == (t * 100000 + i) * 0.5);
+        }
+    }
+    bool reserved_rejected = false;
+    try {
+        net_exposure.put(numeric_limits<int64_t>::min(), 1.0);
+    } catch (const invalid_argument&) {
+        reserved_rejected = true;
+    }
+    net_exposure.put(7, -0.0);
+    net_exposure.put(7, 2.5);
+    net_exposure.clear();
+    if (exposure_ok && reserved_rejected && net_exposure.size() == 0 && !net_exposure.contains(7)) {
+        cout << "10000 of 20000 accounts left, every read saw its own write ✓\n\n";
+    }
+
+    // Test 25: Read-mostly snapshots
+    cout << "Test 25: SnapshotHashMap readers always see whole versions\n";
+    SnapshotHashMap<string, int> desk_limits;
+    desk_limits.update([](auto& batch) {
+        for (int i = 0; i < 1000; i++) {
+            batch.put("DESK" + to_string(i), 100);
+        }
+    });
+    atomic<bool> publishing{true};
+    atomic<bool> snapshots_whole{true};
+    vector<thread> limit_readers;
+    for (int t = 0; t < 3; t++) {
+        limit_readers.emplace_back([&desk_limits, &publishing, &snapshots_whole]() {
+            while (publishing) {
+                long total = 0;
+                size_t entries = 0;
+                desk_limits.for_each_const([&](const string&, int limit) {
+                    total += limit;
+                    ++entries;
+                });
+                if (total != 100000 || entries != 1000 || !desk_limits.get("DESK0")) {
+                    snapshots_whole = false;
+                }
+            }
+        });
+    }
+    // Every batch moves limit between two desks, so the total only holds if
+    // readers never see half a batch. 300 batches also force the delta to be
+    // folded into a new base a couple of times.
+    for (int round = 0; round < 300; round++) {
+        string from = "DESK" + to_string(round % 1000);
+        string to = "DESK" + to_string((round * 7 + 1) % 1000);
+        desk_limits.update([&](auto& batch) {
+            int from_limit = *desk_limits.get(from);
+            int to_limit = *desk_limits.get(to);
+            batch.put(from, from_limit - 10);
+            batch.put(to, to_limit + 10);
+        });
+    }
+    publishing = false;
+    for (auto& reader : limit_readers) {
+        reader.join();
+    }
+    desk_limits.put("DESK1000", 5);
+    bool removed_existing = desk_limits.remove("DESK999");
+    bool removed_missing = desk_limits.remove("DESK999");
+    bool desks_ok = snapshots_whole && removed_existing && !removed_missing &&
+                    desk_limits.size() == 1000 && desk_limits.get("DESK1000") == 5 &&
+                    !desk_limits.contains("DESK999");
+    desk_limits.clear();
+
+    // A map written a few times a day must not keep old versions around
+    // until the writer has retired enough of them to trigger a collect.
+    {
+        SnapshotHashMap<int, DeskLimit> intraday_limits;
+        atomic<bool> reloading{true};
+        thread limit_reader([&intraday_limits, &reloading]() {
+            while (reloading) {
+                intraday_limits.get(0);
+            }
+        });
+        // Each reload adds 100 desks, enough to fold into a new base.
+        auto reload = [&intraday_limits](int round) {
+            intraday_limits.update([round](auto& batch) {
+                for (int i = 0; i < 100; i++) {
+                    batch.put(round * 100 + i, DeskLimit(i));
+                }
+            });
+        };
+        for (int round = 0; round < 5; round++) {
+            reload(round);
+        }
+        reloading = false;
+        limit_reader.join();
+        reload(5);
+        desks_ok = desks_ok && intraday_limits.size() == 600 && DeskLimit::live == 600;
+    }
+
+    if (desks_ok && desk_limits.size() == 0 && !desk_limits.contains("DESK0") && DeskLimit::live == 0) {
+        cout << "300 batches published, every snapshot summed to 100000, old versions freed ✓\n\n";
+    }
+
+    // Test 26: NUMA shards and replicas
+    cout << "Test 26: NumaShardedHashMap, partitioned and replicated\n";
+    bool numa_ok = true;
+    for (NumaMode mode : {NumaMode::Partitioned, NumaMode::Replicated}) {
+        NumaShardedHashMap<int, long, 64> books(mode);
+        vector<thread> numa_writers;
+        for (int t = 0; t < 4; t++) {
+            numa_writers.emplace_back([&books, t]() {
+                for (int i = 0; i < 5000; i++) {
+                    books.put(t * 5000 + i, i);
+                }
+                for (int i = 0; i < 5000; i += 5) {
+                    books.remove(t * 5000 + i);
+                }
+            });
+        }
+        for (auto& w : numa_writers) {
+            w.join();
+        }
+        numa_ok = numa_ok && books.size() == 16000 && books.get(1) == 1 && !books.contains(5000) &&
+                  books.home_node(42) < books.node_count();
+        books.clear();
+        numa_ok = numa_ok && books.size() == 0 && !books.get(1);
+    }
+    if (numa_ok) {
+        cout << "Both modes agree on " << NumaTopology::node_count() << " node(s) ✓\n\n";
+    }
+
+    // Test 27: Flat-combining writes
+    cout << "Test 27: FlatCombining merges on hot keys and puts during a resize\n";
+    ConcurrentHashMap<int, long, 16, hash<int>, equal_to<int>, CombiningTraits> hot_books;
+    vector<thread> combiners;
+    for (int t = 0; t < 6; t++) {
+        combiners.emplace_back([&hot_books, t]() {
+            for (int i = 0; i < 5000; i++) {
+                hot_books.merge(i % 4, 1L, plus<>());
+                hot_books.put(1000 + t * 5000 + i, i);
+                if (i % 100 == 0) {
+                    hot_books.compute(4, [](const long* current) -> optional<long> {
+                        return current ? *current + 1 : 1;
+                    });
+                    hot_books.compute_if_absent(5, []() { return 0L; });
+                    hot_books.compute_if_present(5, [](long& fills) { ++fills; });
+                }
+            }
+        });
+    }
+    for (auto& c : combiners) {
+        c.join();
+    }
+    bool hot_ok = hot_books.size() == 6 + 30000 && hot_books.get(4) == 300 && hot_books.get(5) == 300;
+    for (int k = 0; k < 4; k++) {
+        hot_ok = hot_ok && hot_books.get(k) == 7500;
+    }
+    bool rethrown = false;
+    try {
+        hot_books.compute(0, [](const long*) -> optional<long> { throw runtime_error("rejected"); });
+    } catch (const runtime_error&) {
+        rethrown = true;
+    }
+    // Readers overlapping on one bucket never let its reader count reach
+    // zero, so a poster has to queue for the lock rather than keep trying it.
+    ConcurrentHashMap<int, long, 16, hash<int>, equal_to<int>, SpinCombiningTraits> watched_books;
+    atomic<bool> tallied{false};
+    vector<thread> book_readers;
+    for (int t = 0; t < 3; t++) {
+        book_readers.emplace_back([&watched_books, &tallied]() {
+            while (!tallied.load()) {
+                watched_books.get(0);
+            }
+        });
+    }
+    for (int i = 0; i < 2000; i++) {
+        watched_books.merge(0, 1L, plus<>());
+    }
+    tallied = true;
+    for (auto& l : book_readers) {
+        l.join();
+    }
+    if (hot_ok && rethrown && hot_books.get(0) == 7500 && hot_books.bucket_count() > 16 &&
+        watched_books.get(0) == 2000) {
+        cout << "4 hot keys at 7500 each, 30000 puts across resizes, writers not starved by readers ✓\n\n";
+    }
+
+    // Test 28: Hot-key read replicas
+    cout << "Test 28: Hot keys are promoted, invalidated by writes and demoted\n";
+    ConcurrentHashMap<int, string, 16, hash<int>, equal_to<int>, HotKeyTraits> mm_quotes;
+    for (int i = 0; i < 1000; i++) {
+        mm_quotes.put(i, "q" + to_string(i));
+    }
+    for (int i = 0; i < 200000; i++) {
+        mm_quotes.get(7);
+    }
+    bool promoted = mm_quotes.hot_keys() == vector<int>{7};
+    mm_quotes.put(7, "updated");
+    bool invalidated = mm_quotes.get(7) == "updated";
+    mm_quotes.remove(7);
+    invalidated = invalidated && !mm_quotes.get(7) && !mm_quotes.contains(7);
+    mm_quotes.put(7, "q7");
+
+    atomic<bool> quoting{true};
+    atomic<bool> mm_ok{true};
+    vector<thread> quote_readers;
+    for (int t = 0; t < 4; t++) {
+        quote_readers.emplace_back([&mm_quotes, &quoting, &mm_ok]() {
+            int last = -1;
+            while (quoting.load()) {
+                optional<string> quote = mm_quotes.get(7);
+                int seen = quote && (*quote)[0] == 'v' ? stoi(quote->substr(1)) : -1;
+                if (!quote || seen < last) {
+                    mm_ok = false;
+                }
+                last = seen;
+            }
+            if (mm_quotes.get(7) != "v1999") {
+                mm_ok = false;
+            }
+        });
+    }
+    for (int i = 0; i < 2000; i++) {
+        mm_quotes.put(7, "v" + to_string(i));
+        mm_quotes.put(1000 + i, "q");
+    }
+    quoting = false;
+    for (auto& r : quote_readers) {
+        r.join();
+    }
+
+    for (int i = 0; i < 300000; i++) {
+        mm_quotes.get(i % 1000);
+    }
+    if (promoted && invalidated && mm_ok && mm_quotes.bucket_count() > 16 && mm_quotes.hot_keys().empty()) {
+        cout << "Key 7 promoted, never stale across 2000 writes and resizes, demoted when cold ✓\n\n";
+    }
+
     cout << "All tests passed! ✓✓✓\n";
 
     return 0;